@@ -30,6 +30,33 @@ auto askQuestion(string_view text, vector<string> questions) -> string {
   return MessageDialog().setTitle("beat").setAlignment(programWindow).setText(text).question(questions);
 }
 
+//patches may also be distributed inside a .zip archive, or gzip-compressed;
+//these are decompressed while the patch is being applied, rather than extracted first
+auto PatchFile::open(const string& location) -> bool {
+  if(location.iendsWith(".zip")) {
+    if(!zip.open(location)) return false;
+    for(auto& file : zip.file) {
+      if(file.name.iendsWith(".bps")) return stream = zip.stream(file, intact), true;
+    }
+    return false;
+  }
+
+  if(!map.open(location, file::mode::read)) return false;
+  if(location.iendsWith(".gz")) return stream = gzip.stream(map.data(), map.size(), intact), (bool)stream;
+
+  array_view<uint8_t> data{map.data(), map.size()};
+  bool pending = true;
+  stream = [=]() mutable -> array_view<uint8_t> {
+    if(!pending) return {};
+    return pending = false, data;
+  };
+  return true;
+}
+
+auto PatchFile::isPatch(const string& location) -> bool {
+  return location.iendsWith(".bps") || location.iendsWith(".zip") || location.iendsWith(".gz");
+}
+
 ApplyPatch::ApplyPatch() {
   setCollapsible();
   setVisible(false);
@@ -39,7 +66,7 @@ ApplyPatch::ApplyPatch() {
   patchHeader.setText("Step 1: choose the patch file to apply:");
   patchSelect.setText("Select").onActivate([&] {
     string location = BrowserDialog()
-    .setFilters({{"BPS patches|*.bps"}, {"All files|*"}})
+    .setFilters({{"BPS patches|*.bps:*.zip:*.gz"}, {"All files|*"}})
     .setPath(defaultPath)
     .setTitle("Select patch file")
     .setAlignment(programWindow)
@@ -141,9 +168,16 @@ auto ApplyPatch::apply() -> void {
   string manifest;
   string result;
 
-  auto patchData = file::read(patchLocation);
+  PatchFile patch;
+  if(!patch.open(patchLocation)) {
+    showError("Patching failed with the error: patch file could not be read.");
+    programWindow.setTitle({Information::Name, " ", Information::Version});
+    programWindow.layout.setEnabled(true);
+    return;
+  }
   auto originalData = file::read(originalLocation);
-  auto modifiedData = Beat::Single::apply(originalData, patchData, manifest, result);
+  auto modifiedData = Beat::Single::apply(originalData, patch.stream, manifest, result);
+  if(!patch.intact) modifiedData.reset(), result = "error: patch file is corrupt";
 
   if(result.beginsWith("error: ")) {
     result.trimLeft("error: ", 1L);
@@ -261,6 +295,9 @@ CreatePatch::CreatePatch() {
   });
   modifiedLabel.setFont(Font().setBold());
 
+  sectorsOption.setText("Files are raw CD-ROM images: omit Mode 1 EDC and ECC data (older patchers cannot apply it)");
+  compressOption.setText("Compress the patch (smaller, but older patchers cannot apply it)");
+
   createHeader.setText("Step 4: create the patch:");
   createButton.setText("Create").onActivate([&] { create(); });
 
@@ -299,7 +336,10 @@ auto CreatePatch::create() -> void {
 
   auto originalData = file::read(originalLocation);
   auto modifiedData = file::read(modifiedLocation);
-  auto patchData = Beat::Single::create(originalData, modifiedData);
+  auto patchData = sectorsOption.checked()
+  ? Beat::Single::createSectors(originalData, modifiedData)
+  : Beat::Single::create(originalData, modifiedData);
+  if(compressOption.checked()) patchData = Beat::Single::compress(patchData);
   file::write(patchLocation, patchData);
 
   if(askQuestion({
@@ -327,8 +367,8 @@ Home::Home() {
     "  Choose an action from the left-hand panel.\n"
     "\n"
     "Command-line usage:\n"
-    "  beat -apply:bps [-unsafe] {patch.bps} {original.file} [{modified.file}]\n"
-    "  beat -create:bps {patch.bps} {original.file} {modified.file}"
+    "  beat -apply:bps [-unsafe] {patch.bps|.zip|.gz} {original.file} [{modified.file}]\n"
+    "  beat -create:bps [-sectors] [-compress] {patch.bps} {original.file} {modified.file}"
   });
   aboutButton.setText("About").onActivate([&] {
     AboutDialog()
@@ -389,7 +429,7 @@ auto nall::main(Arguments arguments) -> void {
 
     string patchName = arguments.take();
     if(!file::exists(patchName)) return print("error: patch filename does not exist\n");
-    if(!patchName.endsWith(".bps")) return print("error: patch filename must end with .bps\n");
+    if(!PatchFile::isPatch(patchName)) return print("error: patch filename must end with .bps, .zip or .gz\n");
 
     string originalName = arguments.take();
     if(!file::exists(originalName)) return print("error: original filename does not exist\n");
@@ -399,11 +439,13 @@ auto nall::main(Arguments arguments) -> void {
     if(!modifiedName) modifiedName = originalName;
     if(modifiedName.endsWith(".bps")) return print("error: modified filename must not end with .bps\n");
 
-    auto patchData = file::read(patchName);
+    PatchFile patch;
+    if(!patch.open(patchName)) return print("error: patch file could not be read\n");
     auto originalData = file::read(originalName);
     string manifest;
     string result;
-    auto modifiedData = Beat::Single::apply(originalData, patchData, manifest, result);
+    auto modifiedData = Beat::Single::apply(originalData, patch.stream, manifest, result);
+    if(!patch.intact) modifiedData.reset(), result = "error: patch file is corrupt";
 
     if(result && !unsafe) return print(result, "\n");
     if(result) print(result, "\n");
@@ -414,6 +456,9 @@ auto nall::main(Arguments arguments) -> void {
   }
 
   if(arguments.take("-create:bps")) {
+    bool compress = arguments.take("-compress");
+    bool sectors = arguments.take("-sectors");
+
     string patchName = arguments.take();
     if(!patchName.endsWith(".bps")) return print("error: patch filename must end with .bps\n");
 
@@ -429,7 +474,10 @@ auto nall::main(Arguments arguments) -> void {
 
     auto originalData = file::read(originalName);
     auto modifiedData = file::read(modifiedName);
-    auto patchData = Beat::Single::create(originalData, modifiedData);
+    auto patchData = sectors
+    ? Beat::Single::createSectors(originalData, modifiedData)
+    : Beat::Single::create(originalData, modifiedData);
+    if(compress) patchData = Beat::Single::compress(patchData);
 
     file::write(patchName, patchData);
     return print("patch created successfully\n");
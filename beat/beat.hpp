@@ -1,11 +1,26 @@
 #include <nall/nall.hpp>
 #include <nall/beat/single/apply.hpp>
 #include <nall/beat/single/create.hpp>
+#include <nall/decode/gzip.hpp>
+#include <nall/decode/zip.hpp>
 using namespace nall;
 
 #include <hiro/hiro.hpp>
 using namespace hiro;
 
+struct PatchFile {
+  static auto isPatch(const string& location) -> bool;
+  auto open(const string& location) -> bool;
+
+  function<array_view<uint8_t> ()> stream;
+  bool intact = true;  //false if a compressed patch was corrupt or truncated, once stream has ended
+
+private:
+  file_map map;
+  Decode::ZIP zip;
+  Decode::GZIP gzip;
+};
+
 struct ApplyPatch : VerticalLayout {
   ApplyPatch();
   auto synchronize() -> void;
@@ -72,6 +87,8 @@ protected:
   HorizontalLayout modifiedLayout{this, Size{~0, 0}};
     Button modifiedSelect{&modifiedLayout, Size{80_sx, 0}};
     Label modifiedLabel{&modifiedLayout, Size{~0, 0}};
+  CheckLabel sectorsOption{this, Size{~0, 0}};
+  CheckLabel compressOption{this, Size{~0, 0}};
 
   Label createHeader{this, Size{~0, 0}};
   HorizontalLayout createLayout{this, Size{~0, 0}};
@@ -9,6 +9,7 @@
 #include <nall/traits.hpp>
 
 #include <nall/arithmetic/unsigned.hpp>
+#include <nall/arithmetic/limbs.hpp>
 
 namespace nall {
   template<uint Bits> struct ArithmeticNatural;
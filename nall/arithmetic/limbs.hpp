@@ -0,0 +1,130 @@
+#pragma once
+
+//fixed-width kernels over little-endian arrays of 64-bit limbs:
+//when the compiler provides a native 128-bit type, the natural types route multiplication
+//and division through these, rather than recursing through their halves
+
+namespace nall::Arithmetic {
+
+#if INTMAX_BITS >= 128
+#define NALL_ARITHMETIC_LIMBS
+
+alwaysinline auto load(const uint128_t& value, uint64_t* limbs) -> void {
+  limbs[0] = value;
+  limbs[1] = value >> 64;
+}
+
+alwaysinline auto store(const uint64_t* limbs, uint128_t& value) -> void {
+  value = (uint128_t)limbs[1] << 64 | limbs[0];
+}
+
+//the number of limbs, ignoring leading zeroes
+alwaysinline auto significant(const uint64_t* x, uint limbs) -> uint {
+  while(limbs && !x[limbs - 1]) limbs--;
+  return limbs;
+}
+
+//r[0, N) = (a * b) mod 2^(64 * N)
+template<uint N> alwaysinline auto multiply(uint64_t* r, const uint64_t* a, const uint64_t* b) -> void {
+  for(uint i = 0; i < N; i++) r[i] = 0;
+  for(uint i = 0; i < N; i++) {
+    uint128_t carry = 0;
+    for(uint j = 0; j < N - i - 1; j++) {
+      carry += (uint128_t)a[i] * b[j] + r[i + j];
+      r[i + j] = carry;
+      carry >>= 64;
+    }
+    r[N - 1] += a[i] * b[N - i - 1] + (uint64_t)carry;
+  }
+}
+
+//r[0, 2 * N) = a * b
+template<uint N> alwaysinline auto multiplyFull(uint64_t* r, const uint64_t* a, const uint64_t* b) -> void {
+  for(uint i = 0; i < 2 * N; i++) r[i] = 0;
+  uint m = significant(a, N);
+  uint n = significant(b, N);
+  for(uint i = 0; i < m; i++) {
+    uint128_t carry = 0;
+    for(uint j = 0; j < n; j++) {
+      carry += (uint128_t)a[i] * b[j] + r[i + j];
+      r[i + j] = carry;
+      carry >>= 64;
+    }
+    r[i + n] = carry;
+  }
+}
+
+//q = u / v, r = u % v (Knuth, TAOCP volume 2, algorithm 4.3.1 D); v must be non-zero
+template<uint N> inline auto divide(const uint64_t* u, const uint64_t* v, uint64_t* q, uint64_t* r) -> void {
+  for(uint i : range(N)) q[i] = 0, r[i] = 0;
+  uint m = significant(u, N);
+  uint n = significant(v, N);
+  if(m < n) {
+    for(uint i : range(m)) r[i] = u[i];
+    return;
+  }
+
+  //single-limb divisors only need one 128-bit by 64-bit division per limb
+  if(n == 1) {
+    uint64_t remainder = 0;
+    for(uint i = m; i--;) {
+      uint128_t dividend = (uint128_t)remainder << 64 | u[i];
+      q[i] = dividend / v[0];
+      remainder = dividend % v[0];
+    }
+    r[0] = remainder;
+    return;
+  }
+
+  //normalize, so that the divisor's most significant bit is set
+  uint shift = __builtin_clzll(v[n - 1]);
+  uint64_t vn[N], un[N + 1];
+  for(uint i = n - 1; i > 0; i--) vn[i] = v[i] << shift | (shift ? v[i - 1] >> (64 - shift) : 0);
+  vn[0] = v[0] << shift;
+  un[m] = shift ? u[m - 1] >> (64 - shift) : 0;
+  for(uint i = m - 1; i > 0; i--) un[i] = u[i] << shift | (shift ? u[i - 1] >> (64 - shift) : 0);
+  un[0] = u[0] << shift;
+
+  for(uint j = m - n + 1; j--;) {
+    //estimate the quotient limb from the top two limbs, then correct it from the next one
+    uint128_t dividend = (uint128_t)un[j + n] << 64 | un[j + n - 1];
+    uint128_t qhat = dividend / vn[n - 1];
+    uint128_t rhat = dividend % vn[n - 1];
+    while(qhat >> 64 || qhat * vn[n - 2] > (rhat << 64 | un[j + n - 2])) {
+      qhat--;
+      rhat += vn[n - 1];
+      if(rhat >> 64) break;
+    }
+
+    //multiply and subtract
+    int128_t borrow = 0, t = 0;
+    for(uint i : range(n)) {
+      uint128_t product = qhat * vn[i];
+      t = (int128_t)un[i + j] - borrow - (uint64_t)product;
+      un[i + j] = t;
+      borrow = (int128_t)(product >> 64) - (t >> 64);
+    }
+    t = (int128_t)un[j + n] - borrow;
+    un[j + n] = t;
+
+    //the estimate was one too large: add the divisor back
+    q[j] = qhat;
+    if(t < 0) {
+      q[j]--;
+      uint128_t carry = 0;
+      for(uint i : range(n)) {
+        carry += (uint128_t)un[i + j] + vn[i];
+        un[i + j] = carry;
+        carry >>= 64;
+      }
+      un[j + n] += carry;
+    }
+  }
+
+  //denormalize the remainder
+  for(uint i : range(n)) r[i] = un[i] >> shift | (shift ? un[i + 1] << (64 - shift) : 0);
+}
+
+#endif
+
+}
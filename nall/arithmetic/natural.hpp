@@ -153,6 +153,24 @@ template<typename T> alwaysinline auto _get(const Pair& lhs, T& rhs) -> enable_i
 alwaysinline auto upper(const Pair& value) -> Type { return value.hi; }
 alwaysinline auto lower(const Pair& value) -> Type { return value.lo; }
 
+#if defined(NALL_ARITHMETIC_LIMBS)
+#define Limbs (PairBits / 64)
+
+namespace Arithmetic {
+  alwaysinline auto load(const Pair& value, uint64_t* limbs) -> void {
+    load(lower(value), limbs);
+    load(upper(value), limbs + Limbs / 2);
+  }
+
+  alwaysinline auto store(const uint64_t* limbs, Pair& value) -> void {
+    Type lo, hi;
+    store(limbs, lo);
+    store(limbs + Limbs / 2, hi);
+    value = {hi, lo};
+  }
+}
+#endif
+
 alwaysinline auto bits(Pair value) -> uint {
   if(value.hi) {
     uint bits = TypeBits;
@@ -165,12 +183,47 @@ alwaysinline auto bits(Pair value) -> uint {
   }
 }
 
+//with native 128-bit halves, the generic code below already multiplies whole 64-bit limbs;
+//wider types use the limb kernels instead of recursing
+#if defined(NALL_ARITHMETIC_LIMBS) && PairBits >= 512
+
+//Bits * Bits => Bits
+alwaysinline auto mul(const Pair& lhs, const Pair& rhs) -> Pair {
+  uint64_t a[Limbs], b[Limbs], r[Limbs];
+  Arithmetic::load(lhs, a);
+  Arithmetic::load(rhs, b);
+  Arithmetic::multiply<Limbs>(r, a, b);
+  Pair result;
+  Arithmetic::store(r, result);
+  return result;
+}
+
+//Bits * Bits => 2 * Bits
+alwaysinline auto mul(const Pair& lhs, const Pair& rhs, Pair& hi, Pair& lo) -> void {
+  uint64_t a[Limbs], b[Limbs], r[2 * Limbs];
+  Arithmetic::load(lhs, a);
+  Arithmetic::load(rhs, b);
+  Arithmetic::multiplyFull<Limbs>(r, a, b);
+  Arithmetic::store(r, lo);
+  Arithmetic::store(r + Limbs, hi);
+}
+
+inline auto square(const Pair& lhs) -> Pair {
+  return mul(lhs, lhs);
+}
+
+inline auto square(const Pair& lhs, Pair& hi, Pair& lo) -> void {
+  mul(lhs, lhs, hi, lo);
+}
+
+#else
+
 //Bits * Bits => Bits
 inline auto square(const Pair& lhs) -> Pair {
   static const Type Mask = (Type(0) - 1) >> HalfBits;
   Type a = lhs.hi >> HalfBits, b = lhs.hi & Mask, c = lhs.lo >> HalfBits, d = lhs.lo & Mask;
-  Type dd = square(d), dc = d * c, db = d * b, da = d * a;
-  Type cc = square(c), cb = c * b;
+  Type dd = d * d, dc = d * c, db = d * b, da = d * a;
+  Type cc = c * c, cb = c * b;
 
   Pair r0 = Pair(dd);
   Pair r1 = Pair(dc) + Pair(dc) + Pair(r0 >> HalfBits);
@@ -184,10 +237,10 @@ inline auto square(const Pair& lhs) -> Pair {
 inline auto square(const Pair& lhs, Pair& hi, Pair& lo) -> void {
   static const Type Mask = (Type(0) - 1) >> HalfBits;
   Type a = lhs.hi >> HalfBits, b = lhs.hi & Mask, c = lhs.lo >> HalfBits, d = lhs.lo & Mask;
-  Type dd = square(d), dc = d * c, db = d * b, da = d * a;
-  Type cc = square(c), cb = c * b, ca = c * a;
-  Type bb = square(b), ba = b * a;
-  Type aa = square(a);
+  Type dd = d * d, dc = d * c, db = d * b, da = d * a;
+  Type cc = c * c, cb = c * b, ca = c * a;
+  Type bb = b * b, ba = b * a;
+  Type aa = a * a;
 
   Pair r0 = Pair(dd);
   Pair r1 = Pair(dc) + Pair(dc) + Pair(r0 >> HalfBits);
@@ -235,6 +288,22 @@ alwaysinline auto mul(const Pair& lhs, const Pair& rhs, Pair& hi, Pair& lo) -> v
   lo = {(r3.lo & Mask) << HalfBits | (r2.lo & Mask), (r1.lo & Mask) << HalfBits | (r0.lo & Mask)};
 }
 
+#endif
+
+#if defined(NALL_ARITHMETIC_LIMBS)
+
+inline auto div(const Pair& lhs, const Pair& rhs, Pair& quotient, Pair& remainder) -> void {
+  if(!rhs) throw std::runtime_error("division by zero");
+  uint64_t u[Limbs], v[Limbs], q[Limbs], r[Limbs];
+  Arithmetic::load(lhs, u);
+  Arithmetic::load(rhs, v);
+  Arithmetic::divide<Limbs>(u, v, q, r);
+  Arithmetic::store(q, quotient);
+  Arithmetic::store(r, remainder);
+}
+
+#else
+
 alwaysinline auto div(const Pair& lhs, const Pair& rhs, Pair& quotient, Pair& remainder) -> void {
   if(!rhs) throw std::runtime_error("division by zero");
   quotient = 0, remainder = lhs;
@@ -250,6 +319,8 @@ alwaysinline auto div(const Pair& lhs, const Pair& rhs, Pair& quotient, Pair& re
   }
 }
 
+#endif
+
 template<typename T> alwaysinline auto shl(const Pair& lhs, const T& rhs) -> Pair {
   if(!rhs) return lhs;
   auto shift = (uint)rhs;
@@ -340,3 +411,4 @@ template<> struct stringify<Pair> {
 #undef Type
 #undef Half
 #undef Cast
+#undef Limbs
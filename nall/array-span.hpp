@@ -20,20 +20,20 @@ template<typename T> struct array_span : array_view<T> {
 
   inline array_span(void* data, uint64_t size) {
     super::_data = (T*)data;
-    super::_size = (int)size;
+    super::_size = (int64_t)size;
   }
 
   inline operator T*() { return (T*)super::operator const T*(); }
 
-  inline auto operator[](uint index) -> T& { return (T&)super::operator[](index); }
+  inline auto operator[](uint64_t index) -> T& { return (T&)super::operator[](index); }
 
   template<typename U = T> inline auto data() -> U* { return (U*)super::_data; }
 
-  inline auto begin() -> iterator<T> { return {(T*)super::_data, (uint)0}; }
-  inline auto end() -> iterator<T> { return {(T*)super::_data, (uint)super::_size}; }
+  inline auto begin() -> iterator<T> { return {(T*)super::_data, (uint64_t)0}; }
+  inline auto end() -> iterator<T> { return {(T*)super::_data, (uint64_t)super::_size}; }
 
-  inline auto rbegin() -> reverse_iterator<T> { return {(T*)super::_data, (uint)super::_size - 1}; }
-  inline auto rend() -> reverse_iterator<T> { return {(T*)super::_data, (uint)-1}; }
+  inline auto rbegin() -> reverse_iterator<T> { return {(T*)super::_data, (uint64_t)super::_size - 1}; }
+  inline auto rend() -> reverse_iterator<T> { return {(T*)super::_data, (uint64_t)-1}; }
 
   auto write(T value) -> void {
     operator[](0) = value;
@@ -41,12 +41,12 @@ template<typename T> struct array_span : array_view<T> {
     super::_size--;
   }
 
-  auto span(uint offset, uint length) const -> type {
+  auto span(uint64_t offset, uint64_t length) const -> type {
     #ifdef DEBUG
     struct out_of_bounds {};
-    if(offset + length >= super::_size) throw out_of_bounds{};
+    if(offset > (uint64_t)super::_size || length > (uint64_t)super::_size - offset || super::_size < 0) throw out_of_bounds{};
     #endif
-    return {super::_data + offset, length};
+    return {(T*)super::_data + offset, length};
   }
 
   //array_span<uint8_t> specializations
@@ -21,7 +21,7 @@ template<typename T> struct array_view {
 
   inline array_view(const void* data, uint64_t size) {
     _data = (const T*)data;
-    _size = (int)size;
+    _size = (int64_t)size;
   }
 
   inline explicit operator bool() const { return _data && _size > 0; }
@@ -43,27 +43,27 @@ template<typename T> struct array_view {
   inline auto operator-=(int distance) -> type& { _data -= distance; _size += distance; return *this; }
   inline auto operator+=(int distance) -> type& { _data += distance; _size -= distance; return *this; }
 
-  inline auto operator[](uint index) const -> const T& {
+  inline auto operator[](uint64_t index) const -> const T& {
     #ifdef DEBUG
     struct out_of_bounds {};
-    if(index >= _size) throw out_of_bounds{};
+    if(_size <= 0 || index >= (uint64_t)_size) throw out_of_bounds{};
     #endif
     return _data[index];
   }
 
-  inline auto operator()(uint index, const T& fallback = {}) const -> T {
-    if(index >= _size) return fallback;
+  inline auto operator()(uint64_t index, const T& fallback = {}) const -> T {
+    if(_size <= 0 || index >= (uint64_t)_size) return fallback;
     return _data[index];
   }
 
   template<typename U = T> inline auto data() const -> const U* { return (const U*)_data; }
   template<typename U = T> inline auto size() const -> uint64_t { return _size * sizeof(T) / sizeof(U); }
 
-  inline auto begin() const -> iterator_const<T> { return {_data, (uint)0}; }
-  inline auto end() const -> iterator_const<T> { return {_data, (uint)_size}; }
+  inline auto begin() const -> iterator_const<T> { return {_data, (uint64_t)0}; }
+  inline auto end() const -> iterator_const<T> { return {_data, (uint64_t)_size}; }
 
-  inline auto rbegin() const -> reverse_iterator_const<T> { return {_data, (uint)_size - 1}; }
-  inline auto rend() const -> reverse_iterator_const<T> { return {_data, (uint)-1}; }
+  inline auto rbegin() const -> reverse_iterator_const<T> { return {_data, (uint64_t)_size - 1}; }
+  inline auto rend() const -> reverse_iterator_const<T> { return {_data, (uint64_t)-1}; }
 
   auto read() -> T {
     auto value = operator[](0);
@@ -72,10 +72,10 @@ template<typename T> struct array_view {
     return value;
   }
 
-  auto view(uint offset, uint length) const -> type {
+  auto view(uint64_t offset, uint64_t length) const -> type {
     #ifdef DEBUG
     struct out_of_bounds {};
-    if(offset + length >= _size) throw out_of_bounds{};
+    if(_size < 0 || offset > (uint64_t)_size || length > (uint64_t)_size - offset) throw out_of_bounds{};
     #endif
     return {_data + offset, length};
   }
@@ -86,18 +86,18 @@ template<typename T> struct array_view {
   template<typename U> auto readvn(U& value, uint size) -> U;
   template<typename U> auto readvi(U& value, uint size) -> U;
 
-  template<typename U> auto readl(U& value, uint offset, uint size) -> U { return view(offset, size).readl(value, size); }
+  template<typename U> auto readl(U& value, int64_t offset, uint size) -> U { return view(offset, size).readl(value, size); }
 
   template<typename U = uint64_t> auto readl(uint size) -> U { U value; return readl(value, size); }
   template<typename U = uint64_t> auto readm(uint size) -> U { U value; return readm(value, size); }
   template<typename U = uint64_t> auto readvn(uint size) -> U { U value; return readvn(value, size); }
   template<typename U =  int64_t> auto readvi(uint size) -> U { U value; return readvi(value, size); }
 
-  template<typename U = uint64_t> auto readl(uint offset, uint size) -> U { U value; return readl(value, offset, size); }
+  template<typename U = uint64_t> auto readl(int64_t offset, uint size) -> U { U value; return readl(value, offset, size); }
 
 protected:
   const T* _data;
-  int _size;
+  int64_t _size;
 };
 
 //array_view<uint8_t>
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <nall/unique-pointer.hpp>
 #include <nall/beat/archive/node.hpp>
 
 namespace nall::Beat::Archive {
@@ -11,16 +12,26 @@ struct Container {
   auto isCompressed() const -> bool { return (bool)compression.type; }
   auto isSigned() const -> bool { return (bool)signature.type; }
   auto isEncrypted() const -> bool { return (bool)encryption.type; }
+  auto isChunked() const -> bool { return (bool)integrity.type; }
 
   auto compressLZSA() -> void;
   auto signEd25519(uint256_t privateKey) -> void;
   auto encryptXChaCha20(uint256_t privateKey, uint192_t nonce = 0) -> void;
+  auto encryptXChaCha20Poly1305(uint256_t privateKey, uint192_t nonce = 0, uint64_t chunkSize = 64_KiB) -> void;
+  auto hashMerkle(uint64_t chunkSize = 1_MiB) -> void;
 
-  auto validate() -> bool;
+  auto validate(bool lazy = false) -> bool;
+  auto validate(uint64_t offset, uint64_t size) -> bool;
   auto decryptXChaCha20(uint256_t privateKey) -> bool;
+  auto decryptXChaCha20Poly1305(uint256_t privateKey, uint threads = 0) -> bool;
   auto verifyEd25519(uint256_t publicKey) -> bool;
+  static auto verifyEd25519(array_view<Container*> containers, uint256_t publicKey, array_span<bool> valid = {}) -> bool;
   auto decompressLZSA() -> bool;
 
+  auto compressBPS(string name, string base, maybe<Container&> archive = {}) -> bool;
+  auto decompress(maybe<Container&> archive = {}) -> bool;
+  auto decompress(shared_pointer<Node> node, maybe<Container&> archive, vector<Node*>& pending) -> bool;
+
   auto append(string name, string location) -> shared_pointer<Node>;
   auto appendPath(string name) -> shared_pointer<Node>;
   auto appendFile(string name, array_view<uint8_t> memory) -> shared_pointer<Node>;
@@ -40,6 +51,10 @@ struct Container {
   auto rbegin() const { return nodes.rbegin(); }
   auto rend() const { return nodes.rend(); }
 
+  static auto merkleLeaf(const uint8_t* data, uint64_t size) -> vector<uint8_t>;
+  static auto merkleRoot(const vector<uint8_t>& hashes, string_view prefix) -> uint256_t;
+  auto merkleMetadata(const uint8_t* head, uint64_t headSize, const uint8_t* tail, uint64_t tailSize, string_view prefix, uint64_t reuse = 0) -> string;
+
   vector<shared_pointer<Node>> nodes;
   vector<uint8_t> memory;
   string metadata;
@@ -59,7 +74,28 @@ struct Container {
     string type;
     uint256_t privateKey = 0;
     uint192_t nonce = 0;
+    uint64_t chunkSize = 0;      //xchacha20-poly1305 only
+    bool authenticated = false;  //set once decryption has authenticated the payload
   } encryption;
+
+  struct Integrity {
+    string type;
+    uint64_t chunkSize = 0;
+    uint64_t size = 0;         //payload bytes covered by the chunk hashes
+    uint256_t root = 0;
+    vector<uint8_t> hashes;    //SHA256 of each chunk, 32 bytes apiece
+    //set once a chunk has been checked against its hash; atomic, so that regions may be validated concurrently
+    unique_pointer<std::atomic<uint8_t>[]> verified;
+
+    auto reset() -> void {
+      type = {};
+      chunkSize = 0;
+      size = 0;
+      root = 0;
+      hashes.reset();
+      verified.reset();
+    }
+  } integrity;
 };
 
 Container::Container(array_view<uint8_t> memory) {
@@ -71,6 +107,7 @@ Container::~Container() {
   metadata = {};
   signature = {};
   encryption = {};
+  integrity.reset();
 }
 
 //
@@ -95,9 +132,33 @@ auto Container::encryptXChaCha20(uint256_t privateKey, uint192_t nonce) -> void
   encryption.nonce = nonce;
 }
 
+//authenticated encryption: the ciphertext is sealed in chunks, each with its own Poly1305 tag,
+//so that decryption rejects tampering without a separate hashing pass over the archive
+auto Container::encryptXChaCha20Poly1305(uint256_t privateKey, uint192_t nonce, uint64_t chunkSize) -> void {
+  encryptXChaCha20(privateKey, nonce);
+  encryption.type = "xchacha20-poly1305";
+  encryption.chunkSize = max<uint64_t>(64, chunkSize & ~63ull);
+}
+
+//stores a SHA256 hash per chunk of the archive payload, combined into a Merkle tree:
+//chunks can be verified in parallel, or on demand when only part of an archive is read
+auto Container::hashMerkle(uint64_t chunkSize) -> void {
+  chunkSize = max(4_KiB, chunkSize);
+  if(integrity.chunkSize != chunkSize) integrity.reset();
+  integrity.type = "merkle";
+  integrity.chunkSize = chunkSize;
+}
+
 //
 
-auto Container::validate() -> bool {
+//lazy: when the archive contains chunk hashes, only the metadata is checked here;
+//extract() then validates the chunks backing each file as it is read, and other callers
+//must validate(offset, size) each region of the payload before trusting it
+auto Container::validate(bool lazy) -> bool {
+  integrity.reset();
+  //the payload of a freshly decrypted authenticated archive need not be hashed again
+  bool authenticated = encryption.authenticated;
+  encryption.authenticated = false;
   array_view<uint8_t> memory = this->memory;
   if(memory.size() < 44) return false;  //8 (metadata size) + 32 (SHA256) + 4 (signature)
 
@@ -106,26 +167,53 @@ auto Container::validate() -> bool {
   if(memory[memory.size() - 2] != 'A') return false;
   if(memory[memory.size() - 1] != '1') return false;
 
-  auto sha256 = memory.readl<uint256_t>(memory.size() - 36, 32);
-  if(Hash::SHA256({memory.data(), memory.size() - 36}).value() != sha256) return false;
-
   auto size = memory.readl<uint64_t>(memory.size() - 44, 8);
+  bool obscured = size & 1ull << 63;
+  size &= ~(1ull << 63);
+  if(size > memory.size() - 44) return false;
 
-  if(size & 1ull << 63) {
-    size -= 1ull << 63;
-    metadata = memory.view(memory.size() - 44 - size, size);
+  metadata = memory.view(memory.size() - 44 - size, size);
+  if(obscured) {
     uint64_t offset = memory.size() - 44 - size;
     for(auto& byte : metadata) byte ^= offset++;
-  } else {
-    metadata = memory.view(memory.size() - 44 - size, size);
   }
 
   auto document = BML::unserialize(metadata);
 
+  if(auto node = document["archive/integrity"]; node.text() == "merkle") {
+    //the Merkle root covers the payload chunks and all metadata preceding the integrity section
+    auto position = metadata.findPrevious(metadata.size(), "\n  integrity: merkle\n");
+    if(!position) return false;
+    //so the integrity section must end the metadata: any lines appended after it would go unhashed
+    auto lines = slice(metadata, *position + 1).split("\n");
+    for(uint n : range(1, lines.size())) {
+      if(lines[n] && !lines[n].beginsWith("    ")) return false;
+    }
+    integrity.type = node.text();
+    integrity.chunkSize = node["chunk"].natural();
+    integrity.size = memory.size() - 44 - size;
+    integrity.root = Decode::Base<57, uint256_t>(node["root"].text());
+    integrity.hashes = Decode::Base64(node["hashes"].text());
+    if(integrity.chunkSize == 0) return false;
+    uint64_t chunks = (integrity.size + integrity.chunkSize - 1) / integrity.chunkSize;
+    if(integrity.hashes.size() != chunks * 32) return false;
+    if(merkleRoot(integrity.hashes, slice(metadata, 0, *position + 1)) != integrity.root) return false;
+    integrity.verified = new std::atomic<uint8_t>[chunks]();
+    if(authenticated) for(uint64_t chunk : range(chunks)) integrity.verified[chunk] = 1;
+    if(!lazy && !validate(0, integrity.size)) return false;
+  } else if(authenticated) {
+    //decryptXChaCha20Poly1305() has already authenticated every chunk of this payload;
+    //the metadata itself is not trusted to make that claim
+  } else {
+    auto sha256 = memory.readl<uint256_t>(memory.size() - 36, 32);
+    if(Hash::SHA256({memory.data(), memory.size() - 36}).value() != sha256) return false;
+  }
+
   if(auto node = document["archive/encryption"]) {
-    if(node.text() == "xchacha20") {
+    if(node.text() == "xchacha20" || node.text() == "xchacha20-poly1305") {
       encryption.type = node.text();
       encryption.nonce = Decode::Base<57, uint192_t>(node["nonce"].text());
+      encryption.chunkSize = node["chunk"].natural();
     }
   }
 
@@ -144,11 +232,50 @@ auto Container::validate() -> bool {
   return true;
 }
 
+//verifies the chunks covering [offset, offset + size) of the stored (compressed or encrypted) payload;
+//always true for archives without Merkle integrity, as validate() has already hashed the entire archive.
+//it is safe to call from several threads at once: a chunk may then be hashed more than once, but never trusted unchecked
+auto Container::validate(uint64_t offset, uint64_t size) -> bool {
+  if(integrity.type != "merkle") return true;
+  if(offset + size > integrity.size || offset + size < offset) return false;
+  if(!size) return true;
+
+  uint64_t first = offset / integrity.chunkSize;
+  uint64_t last = (offset + size - 1) / integrity.chunkSize;
+  std::atomic<bool> valid{true};
+  parallel(last - first + 1, [&](uint64_t index) {
+    uint64_t chunk = first + index;
+    if(integrity.verified[chunk]) return;
+    uint64_t base = chunk * integrity.chunkSize;
+    auto hash = merkleLeaf(memory.data() + base, min(integrity.chunkSize, integrity.size - base));
+    if(memory::compare(hash.data(), integrity.hashes.data() + chunk * 32, 32)) valid = false;
+    else integrity.verified[chunk] = 1;
+  });
+  return valid;
+}
+
 auto Container::decryptXChaCha20(uint256_t privateKey) -> bool {
+  if(!validate(0, integrity.size)) return false;
   encryption.privateKey = privateKey;
   Cipher::XChaCha20 xchacha20{encryption.privateKey, encryption.nonce};
-  auto size = memory.readl<uint64_t>(memory.size() - 44, 8);
-  memory = xchacha20.decrypt(memory.view(0, memory.size() - 44 - size));
+  auto size = memory.readl<uint64_t>(memory.size() - 44, 8) & ~(1ull << 63);
+  memory.resize(memory.size() - 44 - size);
+  xchacha20.decrypt(memory, memory);  //in-place
+  integrity.reset();
+  return true;
+}
+
+//authenticates and decrypts each chunk in parallel; on failure, the archive is left unmodified
+auto Container::decryptXChaCha20Poly1305(uint256_t privateKey, uint threads) -> bool {
+  if(encryption.type != "xchacha20-poly1305") return false;
+  encryption.privateKey = privateKey;
+  Cipher::XChaCha20Poly1305 aead{encryption.privateKey, encryption.nonce, encryption.chunkSize};
+  auto size = memory.readl<uint64_t>(memory.size() - 44, 8) & ~(1ull << 63);
+  auto plaintext = aead.open(memory.view(0, memory.size() - 44 - size), threads);
+  if(!plaintext) return false;
+  memory = move(plaintext());
+  integrity.reset();
+  encryption.authenticated = true;
   return true;
 }
 
@@ -158,13 +285,151 @@ auto Container::verifyEd25519(uint256_t publicKey) -> bool {
   return ed25519.verify(memory.view(0, memory.size() - 44 - size), signature.value, publicKey);
 }
 
+//verifies the signatures of many archives from the same publisher in a single batch,
+//which is several times faster than verifying each archive in turn;
+//when given, valid records which of the archives verified
+auto Container::verifyEd25519(array_view<Container*> containers, uint256_t publicKey, array_span<bool> valid) -> bool {
+  vector<EllipticCurve::Ed25519::Signed> batch;
+  for(auto container : containers) {
+    auto& memory = container->memory;
+    auto size = memory.readl<uint64_t>(memory.size() - 44, 8);
+    batch.append({memory.view(0, memory.size() - 44 - size), container->signature.value, publicKey});
+  }
+  EllipticCurve::Ed25519 ed25519;
+  if(!valid) return ed25519.verify(batch);
+  return ed25519.verify(batch, valid) == batch.size();
+}
+
 auto Container::decompressLZSA() -> bool {
-  memory = Decode::LZSA(memory);
+  if(!validate(0, integrity.size)) return false;
+  auto size = memory.readl<uint64_t>(memory.size() - 44, 8);
+  memory = Decode::LZSA(memory.view(0, memory.size() - 44 - size));
+  integrity.reset();
   return (bool)memory;
 }
 
 //
 
+//leaves and interior nodes are domain-separated to prevent second-preimage attacks
+auto Container::merkleLeaf(const uint8_t* data, uint64_t size) -> vector<uint8_t> {
+  Hash::SHA256 hash;
+  hash.input(0x00);
+  hash.input(data, size);
+  return hash.output();
+}
+
+auto Container::merkleRoot(const vector<uint8_t>& hashes, string_view prefix) -> uint256_t {
+  vector<vector<uint8_t>> level;
+  for(uint64_t offset = 0; offset < hashes.size(); offset += 32) {
+    vector<uint8_t> hash;
+    hash.resize(32);
+    memory::copy(hash.data(), hashes.data() + offset, 32);
+    level.append(move(hash));
+  }
+  level.append(merkleLeaf((const uint8_t*)prefix.data(), prefix.size()));
+
+  while(level.size() > 1) {
+    vector<vector<uint8_t>> parent;
+    for(uint n = 0; n + 1 < level.size(); n += 2) {
+      Hash::SHA256 hash;
+      hash.input(0x01);
+      hash.input(level[n + 0]);
+      hash.input(level[n + 1]);
+      parent.append(hash.output());
+    }
+    if(level.size() & 1) parent.append(level.last());  //odd nodes are promoted unchanged
+    level = move(parent);
+  }
+
+  uint256_t root = 0;
+  for(auto byte : level.first()) root = root << 8 | byte;
+  return root;
+}
+
+//computes the chunk hashes for the payload (head followed by tail) in parallel,
+//and returns the integrity metadata section; the first reuse chunk hashes are kept as-is
+auto Container::merkleMetadata(const uint8_t* head, uint64_t headSize, const uint8_t* tail, uint64_t tailSize, string_view prefix, uint64_t reuse) -> string {
+  uint64_t size = headSize + tailSize;
+  uint64_t chunks = (size + integrity.chunkSize - 1) / integrity.chunkSize;
+  reuse = min(reuse, chunks, integrity.hashes.size() / 32);
+  integrity.size = size;
+  integrity.hashes.resize(chunks * 32);
+  parallel(chunks - reuse, [&](uint64_t index) {
+    uint64_t chunk = reuse + index;
+    uint64_t base = chunk * integrity.chunkSize;
+    uint64_t length = min(integrity.chunkSize, size - base);
+    Hash::SHA256 hash;
+    hash.input(0x00);
+    if(base < headSize) {
+      uint64_t partial = min(length, headSize - base);
+      hash.input(head + base, partial);
+      base += partial;
+      length -= partial;
+    }
+    if(length) hash.input(tail + base - headSize, length);
+    memory::copy(integrity.hashes.data() + chunk * 32, hash.output().data(), 32);
+  });
+  integrity.root = merkleRoot(integrity.hashes, prefix);
+  integrity.verified = new std::atomic<uint8_t>[chunks]();
+  for(uint64_t chunk : range(chunks)) integrity.verified[chunk] = 1;
+
+  string metadata;
+  metadata.append("  integrity: merkle\n");
+  metadata.append("    chunk: ", integrity.chunkSize, "\n");
+  metadata.append("    root: ", Encode::Base<57>(integrity.root), "\n");
+  metadata.append("    hashes: ", Encode::Base64(integrity.hashes, "URI"), "\n");
+  return metadata;
+}
+
+//
+
+//stores file name as a BPS delta against the uncompressed file base;
+//base may reside in another archive, which must then be supplied again to decompress()
+auto Container::compressBPS(string name, string base, maybe<Container&> archive) -> bool {
+  auto node = find(name);
+  if(!node || !node->isFile()) return false;
+  if(!archive) {
+    auto source = find(base);
+    return source && node->compressBPS(*source);
+  }
+  auto source = archive->find(base);
+  auto label = BML::unserialize(archive->metadata)["archive"].text();
+  return source && label && node->compressBPS(*source, label);
+}
+
+//decompresses every file, expanding the bases of BPS deltas before their dependents
+//archive supplies the external base archive, whose files may be decompressed in turn
+auto Container::decompress(maybe<Container&> archive) -> bool {
+  vector<Node*> pending;
+  for(auto& node : nodes) {
+    if(!decompress(node, archive, pending)) return false;
+  }
+  return true;
+}
+
+auto Container::decompress(shared_pointer<Node> node, maybe<Container&> archive, vector<Node*>& pending) -> bool {
+  if(!node->isCompressed()) return true;
+  if(node->compression.type != "bps") return node->decompress();
+  if(pending.find(node.data())) return false;  //circular dependency
+
+  auto owner = this;
+  if(node->compression.archive) {
+    if(!archive) return false;
+    if(BML::unserialize(archive->metadata)["archive"].text() != node->compression.archive) return false;
+    owner = &archive();
+  }
+
+  auto base = owner->find(node->compression.base);
+  if(!base || !base->isFile()) return false;
+
+  pending.append(node.data());
+  bool resolved = owner->decompress(base, owner == this ? archive : nothing, pending);
+  pending.removeRight();
+  if(!resolved) return false;
+
+  return node->decompress(base->memory);
+}
+
 auto Container::append(string name, string location) -> shared_pointer<Node> {
   for(auto& node : nodes) if(node->name == name) return {};
   if(auto node = Node::create(name, location)) return nodes.append(node), node;
@@ -39,26 +39,47 @@ auto create(Container& container, string name) -> vector<uint8_t> {
     metadata.append("    value: ", Encode::Base<57>(container.signature.value), "\n");
   }
 
+  Hash::SHA256 sha256;
+  uint64_t hashed = 0;
+  if(!container.compression.type && !container.encryption.type) {
+    //record a resumable hash state, so that update() need not rehash the existing payload
+    hashed = memory.size() & ~63ull;
+    sha256.input(memory.data(), hashed);
+    metadata.append("  digest: sha256\n");
+    metadata.append("    offset: ", hashed, "\n");
+    metadata.append("    state: ", Encode::Base64(sha256.state(), "URI"), "\n");
+  }
+
+  if(container.integrity.type == "merkle") {
+    metadata.append(container.merkleMetadata(memory.data(), memory.size(), nullptr, 0, metadata));
+  }
+
   for(auto& byte : metadata) memory.append(byte);
   memory.appendl((uint64_t)metadata.size(), 8);
 
-  auto sha256 = Hash::SHA256(memory).value();
-  memory.appendl((uint256_t)sha256, 32);
+  sha256.input(memory.data() + hashed, memory.size() - hashed);
+  memory.appendl(sha256.value(), 32);
 
   memory.append('B');
   memory.append('P');
   memory.append('A');
   memory.append('1');
 
-  if(container.encryption.type == "xchacha20") {
-    Cipher::XChaCha20 xchacha20{container.encryption.privateKey, container.encryption.nonce};
-    memory = xchacha20.encrypt(memory);
-
+  if(container.encryption.type == "xchacha20" || container.encryption.type == "xchacha20-poly1305") {
     metadata = {};
     metadata.append("archive\n");
-    metadata.append("  encryption: xchacha20\n");
+    metadata.append("  encryption: ", container.encryption.type, "\n");
     metadata.append("    nonce: ", Encode::Base<57>(container.encryption.nonce), "\n");
 
+    if(container.encryption.type == "xchacha20") {
+      Cipher::XChaCha20 xchacha20{container.encryption.privateKey, container.encryption.nonce};
+      xchacha20.encrypt(memory, memory);  //in-place
+    } else {
+      Cipher::XChaCha20Poly1305 aead{container.encryption.privateKey, container.encryption.nonce, container.encryption.chunkSize};
+      memory = aead.seal(memory);
+      metadata.append("    chunk: ", container.encryption.chunkSize, "\n");
+    }
+
     if(container.signature.type == "ed25519") {
       EllipticCurve::Ed25519 ed25519;
       container.signature.value = ed25519.sign(memory, container.signature.privateKey);
@@ -68,6 +89,10 @@ auto create(Container& container, string name) -> vector<uint8_t> {
       metadata.append("    value: ", Encode::Base<57>(container.signature.value), "\n");
     }
 
+    if(container.integrity.type == "merkle") {
+      metadata.append(container.merkleMetadata(memory.data(), memory.size(), nullptr, 0, metadata));
+    }
+
     for(auto& byte : metadata) memory.append(byte ^ memory.size());
     memory.appendl((uint64_t)metadata.size() | 1ull << 63, 8);
 
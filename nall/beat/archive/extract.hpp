@@ -5,12 +5,17 @@
 
 namespace nall::Beat::Archive {
 
+//fails if any file's stored bytes do not match the archive's chunk hashes;
+//such files are left out, while the remaining files are still extracted
 auto extract(Container& container) -> bool {
+  bool valid = true;
   function<void (Markup::Node)> extract = [&](auto metadata) {
     if(metadata.name() != "path" && metadata.name() != "file") return;
     shared_pointer<Node> node = new Node;
     if(node->unserialize(container.memory, metadata)) {
-      container.nodes.append(node);
+      //after a lazy validate(), only the chunks backing the files actually read are hashed
+      if(container.validate(node->offset, node->memory.size())) container.nodes.append(node);
+      else valid = false;
     }
     if(metadata.name() != "path") return;
     for(auto node : metadata) extract(node);
@@ -21,7 +26,7 @@ auto extract(Container& container) -> bool {
   for(auto node : document["archive"]) extract(node);
   container.sort();
 
-  return true;
+  return valid;
 }
 
 }
@@ -2,11 +2,19 @@
 
 #include <nall/arithmetic.hpp>
 #include <nall/array-view.hpp>
+#include <nall/parallel.hpp>
 #include <nall/random.hpp>
 #include <nall/cipher/chacha20.hpp>
+#include <nall/cipher/xchacha20-poly1305.hpp>
 #include <nall/elliptic-curve/ed25519.hpp>
 #include <nall/decode/base.hpp>
 #include <nall/encode/base.hpp>
+#include <nall/decode/base64.hpp>
+#include <nall/encode/base64.hpp>
+#include <nall/hash/crc32.hpp>
+#include <nall/hash/sha256.hpp>
+#include <nall/beat/single/apply.hpp>
+#include <nall/beat/single/create.hpp>
 #include <nall/decode/lzsa.hpp>
 #include <nall/encode/lzsa.hpp>
 
@@ -24,9 +32,11 @@ struct Node {
 
   auto metadata(bool indented = true) const -> string;
   auto compressLZSA() -> bool;
+  auto compressBPS(const Node& base, string archive = {}) -> bool;
 
   auto unserialize(array_view<uint8_t> container, Markup::Node metadata) -> bool;
   auto decompress() -> bool;
+  auto decompress(array_view<uint8_t> base) -> bool;
 
   auto getTimestamp(string) const -> uint64_t;
   auto getPermissions() const -> uint;
@@ -67,10 +77,13 @@ struct Node {
   //files only
   vector<uint8_t> memory;
   uint64_t offset = 0;
+  bool resident = false;  //memory is already stored in the archive at offset
 
   struct Compression {
     string type;
-    uint size = 0;  //decompressed size; memory.size() == compressed size
+    uint64_t size = 0;  //decompressed size; memory.size() == compressed size
+    string base;     //bps: name of the file the delta applies to
+    string archive;  //bps: name of the archive containing base; empty for this archive
   } compression;
 };
 
@@ -185,6 +198,10 @@ auto Node::metadata(bool indented) const -> string {
       metadata.append(indent, "  size: ", compression.size, "\n");
       metadata.append(indent, "  compression: ", compression.type, "\n");
       metadata.append(indent, "    size: ", memory.size(), "\n");
+    if(compression.base)
+      metadata.append(indent, "    base: ", compression.base, "\n");
+    if(compression.archive)
+      metadata.append(indent, "    archive: ", compression.archive, "\n");
     }
   }
 
@@ -227,18 +244,22 @@ auto Node::unserialize(array_view<uint8_t> container, Markup::Node metadata) ->
 
   if(isPath()) return true;
 
-  uint offset = metadata["offset"].natural();
-  uint size = metadata["size"].natural();
+  offset = metadata["offset"].natural();
+  uint64_t size = metadata["size"].natural();
 
   if(metadata["compression"]) {
+    compression.size = size;
     size = metadata["compression/size"].natural();
     compression.type = metadata["compression"].text();
+    compression.base = metadata["compression/base"].text();
+    compression.archive = metadata["compression/archive"].text();
   }
 
-  if(offset + size >= container.size()) return false;
+  if(offset + size > container.size()) return false;
 
   memory.reallocate(size);
   nall::memory::copy(memory.data(), container.view(offset, size), size);
+  resident = true;
   return true;
 }
 
@@ -255,6 +276,23 @@ auto Node::compressLZSA() -> bool {
   return true;
 }
 
+//stores the file as a BPS delta against base, which must not itself be compressed
+auto Node::compressBPS(const Node& base, string archive) -> bool {
+  if(!memory) return true;  //don't compress empty files
+  if(isCompressed()) return true;  //don't recompress files
+  if(!base.isFile() || base.isCompressed() || base.name == name && !archive) return false;
+
+  auto compressedMemory = Beat::Single::create(base.memory, memory);
+  if(compressedMemory.size() >= memory.size()) return true;  //can't compress smaller than original size
+
+  compression.type = "bps";
+  compression.size = memory.size();
+  compression.base = base.name;
+  compression.archive = archive;
+  memory = move(compressedMemory);
+  return true;
+}
+
 auto Node::decompress() -> bool {
   if(!isCompressed()) return true;
 
@@ -264,7 +302,17 @@ auto Node::decompress() -> bool {
     return (bool)memory;
   }
 
-  return false;
+  return false;  //bps requires the decompressed base file
+}
+
+auto Node::decompress(array_view<uint8_t> base) -> bool {
+  if(compression.type != "bps") return decompress();
+
+  auto target = Beat::Single::apply(base, memory);
+  if(!target || target->size() != compression.size) return false;
+  compression = {};
+  memory = move(*target);
+  return true;
 }
 
 auto Node::getTimestamp(string type) const -> uint64_t {
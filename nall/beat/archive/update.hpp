@@ -0,0 +1,91 @@
+#pragma once
+
+#include <nall/beat/archive/node.hpp>
+#include <nall/beat/archive/container.hpp>
+#include <nall/beat/archive/create.hpp>
+
+namespace nall::Beat::Archive {
+
+//appends new and replaced files to an existing archive without rewriting its payload:
+//the appended metadata and trailer supersede the previous ones, which remain as dead space
+//alongside the payloads of replaced and removed files until the archive is compacted.
+//the container must have been loaded with validate() and extract().
+//returns the bytes to append to the archive file; they are also appended to container.memory
+auto update(Container& container) -> vector<uint8_t> {
+  //whole-archive compression, encryption and signatures cover the entire payload
+  if(container.isCompressed() || container.isEncrypted() || container.isSigned()) return {};
+  auto& archive = container.memory;
+  if(archive.size() < 44) return {};
+  uint64_t base = archive.size();
+
+  auto document = BML::unserialize(container.metadata);
+  auto& metadata = container.metadata;
+  metadata = {};
+  metadata.append("archive: ", document["archive"].text(), "\n");
+
+  vector<uint8_t> memory;
+
+  container.sort();
+  for(auto& node : container.nodes) {
+    if(node->isFile() && !node->resident) {
+      node->offset = base + memory.size();
+      memory.append(node->memory);
+      node->resident = true;
+    }
+    metadata.append(node->metadata());
+  }
+
+  uint64_t size = base + memory.size();
+  metadata.append("  size: ", size, "\n");
+
+  //hashes bytes [from, to) of the archive as it will be once memory is appended
+  auto feed = [&](Hash::SHA256& hash, uint64_t from, uint64_t to) {
+    if(from < base) hash.input(archive.data() + from, min(to, base) - from), from = min(to, base);
+    if(from < to) hash.input(memory.data() + from - base, to - from);
+  };
+
+  //resume the trailer hash from the state recorded by the previous revision, if possible
+  Hash::SHA256 sha256;
+  uint64_t hashed = 0;
+  if(auto digest = document["archive/digest"]; digest.text() == "sha256") {
+    uint64_t offset = digest["offset"].natural();
+    if(offset <= base && sha256.resume(Decode::Base64(digest["state"].text()), offset)) hashed = offset;
+  }
+  feed(sha256, hashed, size & ~63ull);
+  hashed = size & ~63ull;
+  metadata.append("  digest: sha256\n");
+  metadata.append("    offset: ", hashed, "\n");
+  metadata.append("    state: ", Encode::Base64(sha256.state(), "URI"), "\n");
+
+  if(container.integrity.type == "merkle") {
+    //chunks lying entirely within the previous payload are unchanged
+    uint64_t reuse = container.integrity.size / container.integrity.chunkSize;
+    metadata.append(container.merkleMetadata(archive.data(), base, memory.data(), memory.size(), metadata, reuse));
+  }
+
+  for(auto& byte : metadata) memory.append(byte);
+  memory.appendl((uint64_t)metadata.size(), 8);
+
+  feed(sha256, hashed, base + memory.size());
+  memory.appendl(sha256.value(), 32);
+
+  memory.append('B');
+  memory.append('P');
+  memory.append('A');
+  memory.append('1');
+
+  archive.append(memory);
+  return memory;
+}
+
+//rewrites an archive that has been updated, discarding its dead space
+//returns the new archive, which replaces the original file entirely
+auto compact(Container& container) -> vector<uint8_t> {
+  //rewriting would silently drop whole-archive compression, encryption and signatures
+  if(container.isCompressed() || container.isEncrypted() || container.isSigned()) return {};
+  auto document = BML::unserialize(container.metadata);
+  for(auto& node : container.nodes) node->resident = false;
+  return create(container, document["archive"].text());
+}
+
+}
@@ -1,17 +1,190 @@
 #pragma once
 
+#include <nall/decode/huffman.hpp>
+#include <nall/beat/single/sectors.hpp>
+
 namespace nall::Beat::Single {
 
-inline auto apply(array_view<uint8_t> source, array_view<uint8_t> beat, maybe<string&> manifest = {}, maybe<string&> result = {}) -> maybe<vector<uint8_t>> {
+//wraps a patch reader, reassembling patches stored in the entropy-coded envelope (see Beat::Single::compress)
+//one block at a time, by interleaving the decoded streams back into commands; other patches pass through.
+//an invalid envelope ends the patch early, which apply() then reports
+inline auto expand(function<array_view<uint8_t> ()> reader) -> function<array_view<uint8_t> ()> {
+  enum : uint { Detect, Pass, Header, Blocks, Footer, Ended };
+  return [reader, stage = (uint)Detect, input = vector<uint8_t>{}, offset = (uint64_t)0, output = vector<uint8_t>{}]() mutable -> array_view<uint8_t> {
+    //ensures that at least count bytes of the envelope are buffered
+    auto fill = [&](uint64_t count) -> bool {
+      while(input.size() - offset < count) {
+        auto chunk = reader();
+        if(!chunk.size()) return false;
+        uint64_t size = input.size() - offset;
+        ::memmove(input.data(), input.data() + offset, size);
+        input.resize(size + chunk.size());
+        ::memcpy(input.data() + size, chunk.data(), chunk.size());
+        offset = 0;
+      }
+      return true;
+    };
+
+    auto decode = [&](uint64_t& data) -> bool {
+      data = 0;
+      uint64_t shift = 1;
+      while(true) {
+        if(!fill(1) || shift >> 56) return false;
+        uint8_t x = input[offset++];
+        data += (x & 0x7f) * shift;
+        if(x & 0x80) return true;
+        shift <<= 7;
+        data += shift;
+      }
+    };
+
+    auto take = [&](uint64_t size) -> array_view<uint8_t> {
+      array_view<uint8_t> view{input.data() + offset, size};
+      offset += size;
+      return view;
+    };
+
+    if(stage == Detect) {
+      auto chunk = reader();
+      if(chunk.size() >= 4 && memory::compare(chunk.data(), "BPZ1", 4)) return stage = Pass, chunk;
+      input.resize(chunk.size());
+      ::memcpy(input.data(), chunk.data(), chunk.size());
+      if(!fill(4) || memory::compare(input.data(), "BPZ1", 4)) {
+        stage = Pass;
+        output = move(input);
+        return output;
+      }
+      offset = 4;
+      stage = Header;
+    }
+
+    if(stage == Pass) return reader();
+
+    if(stage == Header) {
+      uint64_t size;
+      if(!decode(size) || !fill(size)) return stage = Ended, array_view<uint8_t>{};
+      output.resize(size);
+      ::memcpy(output.data(), take(size).data(), size);
+      stage = Blocks;
+      return output;
+    }
+
+    if(stage == Blocks) {
+      uint64_t sizes[3];
+      if(!decode(sizes[0])) return stage = Ended, array_view<uint8_t>{};
+      if(!sizes[0]) {
+        stage = Footer;
+      } else {
+        if(!decode(sizes[1]) || !decode(sizes[2])) return stage = Ended, array_view<uint8_t>{};
+        if(sizes[0] >> 40 || sizes[1] >> 40 || sizes[2] >> 40) return stage = Ended, array_view<uint8_t>{};
+        if(!fill((sizes[0] >> 1) + (sizes[1] >> 1) + (sizes[2] >> 1))) return stage = Ended, array_view<uint8_t>{};
+        vector<uint8_t> streams[3];
+        for(uint n : range(3)) {
+          auto stream = take(sizes[n] >> 1);
+          if(sizes[n] & 1) {
+            streams[n] = Decode::Huffman(stream);
+            if(!streams[n]) return stage = Ended, array_view<uint8_t>{};
+          } else {
+            streams[n].resize(stream.size());
+            ::memcpy(streams[n].data(), stream.data(), stream.size());
+          }
+        }
+
+        auto& commands = streams[0];
+        auto& offsets = streams[1];
+        auto& literals = streams[2];
+        uint64_t commandOffset = 0, offsetOffset = 0, literalOffset = 0;
+        output.resize(commands.size() + offsets.size() + literals.size());
+        uint8_t* target = output.data();
+
+        //copies one encoded number from a stream, returning its value
+        auto copy = [&](vector<uint8_t>& stream, uint64_t& index, uint64_t& data) -> bool {
+          data = 0;
+          uint64_t shift = 1;
+          while(true) {
+            if(index >= stream.size() || shift >> 56) return false;
+            uint8_t x = stream[index++];
+            *target++ = x;
+            data += (x & 0x7f) * shift;
+            if(x & 0x80) return true;
+            shift <<= 7;
+            data += shift;
+          }
+        };
+
+        enum : uint { SourceRead, TargetRead, SourceCopy, TargetCopy };
+        while(commandOffset < commands.size()) {
+          uint64_t command, relativeOffset;
+          if(!copy(commands, commandOffset, command)) return stage = Ended, array_view<uint8_t>{};
+          uint64_t length = (command >> 2) + 1;
+          if((command & 3) == TargetRead) {
+            if(length > literals.size() - literalOffset) return stage = Ended, array_view<uint8_t>{};
+            ::memcpy(target, literals.data() + literalOffset, length);
+            target += length;
+            literalOffset += length;
+          } else if((command & 3) != SourceRead) {
+            if(!copy(offsets, offsetOffset, relativeOffset)) return stage = Ended, array_view<uint8_t>{};
+          }
+        }
+        if(offsetOffset != offsets.size() || literalOffset != literals.size()) return stage = Ended, array_view<uint8_t>{};
+        return output;
+      }
+    }
+
+    if(stage == Footer) {
+      stage = Ended;
+      if(!fill(12)) return {};
+      output.resize(12);
+      ::memcpy(output.data(), take(12).data(), 12);
+      return output;
+    }
+
+    return {};
+  };
+}
+
+//the patch is pulled from reader in chunks, each of which must remain valid until the next call,
+//and an empty chunk marks its end: so a compressed patch can be decoded as it is applied
+inline auto apply(array_view<uint8_t> source, const function<array_view<uint8_t> ()>& patch, maybe<string&> manifest = {}, maybe<string&> result = {}) -> maybe<vector<uint8_t>> {
   #define error(text) { if(result) *result = {"error: ", text}; return {}; }
   #define warning(text) { if(result) *result = {"warning: ", text}; return target; }
   #define success() { if(result) *result = ""; return target; }
-  if(beat.size() < 19) error("beat size mismatch");
-
   vector<uint8_t> target;
+  auto reader = expand(patch);
+
+  const uint8_t* beat = nullptr;
+  uint64_t beatSize = 0, beatOffset = 0;
+  vector<uint8_t> carry;  //unread bytes of the previous chunk joined with the current chunk
+  bool ended = false, truncated = false;
+  Hash::CRC32 checksum;
+  uint64_t hashed = 0;
+
+  //ensures that at least count bytes are buffered, unless the patch ends first
+  auto fill = [&](uint count) {
+    while(beatSize - beatOffset < count && !ended) {
+      checksum.input(beat + hashed, beatOffset - hashed);
+      vector<uint8_t> next;
+      next.resize(beatSize - beatOffset);
+      memory::copy(next.data(), beat + beatOffset, next.size());
+      auto chunk = reader();
+      if(!chunk.size()) ended = true;
+      if(!next && chunk.size()) {
+        beat = chunk.data();
+        beatSize = chunk.size();
+      } else {
+        next.resize(next.size() + chunk.size());
+        memory::copy(next.data() + next.size() - chunk.size(), chunk.data(), chunk.size());
+        carry = move(next);
+        beat = carry.data();
+        beatSize = carry.size();
+      }
+      beatOffset = hashed = 0;
+    }
+  };
 
-  uint beatOffset = 0;
   auto read = [&]() -> uint8_t {
+    if(beatOffset == beatSize) fill(1);
+    if(beatOffset == beatSize) return truncated = true, 0;
     return beat[beatOffset++];
   };
 
@@ -20,7 +193,7 @@ inline auto apply(array_view<uint8_t> source, array_view<uint8_t> beat, maybe<st
     while(true) {
       uint8_t x = read();
       data += (x & 0x7f) * shift;
-      if(x & 0x80) break;
+      if(x & 0x80 || truncated) break;
       shift <<= 7;
       data += shift;
     }
@@ -31,6 +204,34 @@ inline auto apply(array_view<uint8_t> source, array_view<uint8_t> beat, maybe<st
     target.append(data);
   };
 
+  fill(19);
+  if(beatSize - beatOffset < 19) error("beat size mismatch");
+
+  //sector patches (see Beat::Single::createSectors) map the target's sectors ahead of an ordinary patch,
+  //which is applied between the images with the derivable data of their sectors stripped
+  bool sectors = false;
+  vector<uint8_t> strippedSource;
+  vector<uint64_t> exceptions;
+  uint64_t imageSize = 0;
+  uint32_t imageHash = 0;
+  if(!memory::compare(beat + beatOffset, "BPD1", 4)) {
+    beatOffset += 4;
+    sectors = true;
+    imageSize = decode();
+    uint64_t count = decode();
+    if(count > imageSize / Sectors::SectorSize) error("sector map invalid");
+    for(uint64_t index = 0; count--;) {
+      index += decode();
+      exceptions.append(index++);
+      if(truncated) error("beat size mismatch");
+    }
+    for(uint shift : range(0, 32, 8)) imageHash |= read() << shift;
+    strippedSource = Sectors::strip(source);
+    source = strippedSource;
+    fill(19);
+    if(beatSize - beatOffset < 19) error("beat size mismatch");
+  }
+
   if(read() != 'B') error("beat header invalid");
   if(read() != 'P') error("beat header invalid");
   if(read() != 'S') error("beat header invalid");
@@ -47,7 +248,7 @@ inline auto apply(array_view<uint8_t> source, array_view<uint8_t> beat, maybe<st
   enum : uint { SourceRead, TargetRead, SourceCopy, TargetCopy };
 
   uint sourceRelativeOffset = 0, targetRelativeOffset = 0;
-  while(beatOffset < beat.size() - 12) {
+  while(fill(13), beatSize - beatOffset > 12 && !truncated) {
     uint length = decode();
     uint mode = length & 3;
     length = (length >> 2) + 1;
@@ -55,7 +256,7 @@ inline auto apply(array_view<uint8_t> source, array_view<uint8_t> beat, maybe<st
     if(mode == SourceRead) {
       while(length--) write(source[target.size()]);
     } else if(mode == TargetRead) {
-      while(length--) write(read());
+      while(length-- && !truncated) write(read());
     } else {
       int offset = decode();
       offset = offset & 1 ? -(offset >> 1) : (offset >> 1);
@@ -72,12 +273,23 @@ inline auto apply(array_view<uint8_t> source, array_view<uint8_t> beat, maybe<st
   uint32_t sourceHash = 0, targetHash = 0, beatHash = 0;
   for(uint shift : range(0, 32, 8)) sourceHash |= read() << shift;
   for(uint shift : range(0, 32, 8)) targetHash |= read() << shift;
+  checksum.input(beat + hashed, beatOffset - hashed);
   for(uint shift : range(0, 32, 8)) beatHash   |= read() << shift;
+  if(truncated) error("beat size mismatch");
 
-  if(target.size() != targetSize) warning("target size mismatch");
+  bool targetSizeValid = target.size() == targetSize;
+  bool targetHashValid = targetHash == Hash::CRC32(target).value();
+  if(sectors) {
+    auto image = Sectors::restore(target, exceptions, imageSize);
+    if(!image) error("sector map mismatch");
+    target = move(*image);
+    targetHashValid &= imageHash == Hash::CRC32(target).value();
+  }
+
+  if(!targetSizeValid) warning("target size mismatch");
   if(sourceHash != Hash::CRC32(source).value()) warning("source hash mismatch");
-  if(targetHash != Hash::CRC32(target).value()) warning("target hash mismatch");
-  if(beatHash != Hash::CRC32({beat.data(), beat.size() - 4}).value()) warning("beat hash mismatch");
+  if(!targetHashValid) warning("target hash mismatch");
+  if(beatHash != checksum.value()) warning("beat hash mismatch");
 
   success();
   #undef error
@@ -85,4 +297,12 @@ inline auto apply(array_view<uint8_t> source, array_view<uint8_t> beat, maybe<st
   #undef success
 }
 
+inline auto apply(array_view<uint8_t> source, array_view<uint8_t> beat, maybe<string&> manifest = {}, maybe<string&> result = {}) -> maybe<vector<uint8_t>> {
+  bool pending = true;
+  return apply(source, [&]() -> array_view<uint8_t> {
+    if(!pending) return {};
+    return pending = false, beat;
+  }, manifest, result);
+}
+
 }
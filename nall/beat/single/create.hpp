@@ -1,6 +1,8 @@
 #pragma once
 
 #include <nall/suffix-array.hpp>
+#include <nall/encode/huffman.hpp>
+#include <nall/beat/single/sectors.hpp>
 
 namespace nall::Beat::Single {
 
@@ -96,4 +98,155 @@ inline auto create(array_view<uint8_t> source, array_view<uint8_t> target, strin
   return beat;
 }
 
+//repacks a patch into an entropy-coded envelope, which Beat::Single::apply also accepts:
+//the commands, copy offsets and TargetRead literals are split into three streams, which compress far
+//better apart than interleaved; these are Huffman-coded in blocks of roughly blockSize patch bytes,
+//so that the patch can still be applied as it is read. the original patch is reassembled exactly,
+//and so its checksums remain valid
+//
+//"BPZ1", header size, header (the original patch header, through its manifest)
+//per block: command size, offset size, literal size (each size << 1 | Huffman-coded), streams
+//an empty command stream ends the blocks, followed by the original twelve-byte footer
+inline auto compress(array_view<uint8_t> beat, uint64_t blockSize = 1_MiB) -> vector<uint8_t> {
+  vector<uint8_t> output;
+  if(beat.size() < 4 + 3 + 12) return {};
+  uint64_t offset = 0, end = beat.size() - 12;
+
+  auto write = [&](uint8_t data) {
+    output.append(data);
+  };
+
+  auto encode = [&](uint64_t data) {
+    while(true) {
+      uint64_t x = data & 0x7f;
+      data >>= 7;
+      if(data == 0) { write(0x80 | x); break; }
+      write(x);
+      data--;
+    }
+  };
+
+  //reads a number, appending its encoding to stream; returns false past the end of the commands
+  auto decode = [&](uint64_t& data, vector<uint8_t>* stream) -> bool {
+    data = 0;
+    uint64_t shift = 1;
+    while(true) {
+      if(offset >= end || shift >> 56) return false;
+      uint8_t x = beat[offset++];
+      if(stream) stream->append(x);
+      data += (x & 0x7f) * shift;
+      if(x & 0x80) return true;
+      shift <<= 7;
+      data += shift;
+    }
+  };
+
+  auto signature = [&](const char* value) -> bool {
+    if(end - offset < 4 || memory::compare(beat.data() + offset, value, 4)) return false;
+    return offset += 4, true;
+  };
+
+  //sector patches prefix the patch header with their sector map
+  if(signature("BPD1")) {
+    uint64_t imageSize, exceptions, delta;
+    if(!decode(imageSize, nullptr) || !decode(exceptions, nullptr)) return {};
+    for(uint64_t n : range(exceptions)) if(!decode(delta, nullptr)) return {};
+    if(end - offset < 4) return {};
+    offset += 4;
+  }
+  if(!signature("BPS1")) return {};
+  uint64_t sourceSize, targetSize, manifestSize;
+  if(!decode(sourceSize, nullptr) || !decode(targetSize, nullptr) || !decode(manifestSize, nullptr)) return {};
+  if(manifestSize > end - offset) return {};
+  offset += manifestSize;
+  write('B'), write('P'), write('Z'), write('1');
+  encode(offset);
+  for(uint64_t n : range(offset)) write(beat[n]);
+
+  vector<uint8_t> commands, offsets, literals;
+  auto flush = [&] {
+    if(!commands) return;
+    vector<uint8_t> streams[3] = {move(commands), move(offsets), move(literals)};
+    for(auto& stream : streams) {
+      bool coded = false;
+      if(stream) {
+        auto packed = Encode::Huffman(stream);
+        if(packed.size() < stream.size()) stream = move(packed), coded = true;
+      }
+      encode(stream.size() << 1 | coded);
+    }
+    for(auto& stream : streams) {
+      uint64_t size = output.size();
+      output.resize(size + stream.size());
+      ::memcpy(output.data() + size, stream.data(), stream.size());
+    }
+    commands.reset(), offsets.reset(), literals.reset();
+  };
+
+  enum : uint { SourceRead, TargetRead, SourceCopy, TargetCopy };
+  while(offset < end) {
+    uint64_t command;
+    if(!decode(command, &commands)) return {};
+    uint64_t length = (command >> 2) + 1;
+    if((command & 3) == TargetRead) {
+      if(length > end - offset) return {};
+      uint64_t size = literals.size();
+      literals.resize(size + length);
+      ::memcpy(literals.data() + size, beat.data() + offset, length);
+      offset += length;
+    } else if((command & 3) != SourceRead) {
+      uint64_t relativeOffset;
+      if(!decode(relativeOffset, &offsets)) return {};
+    }
+    if(commands.size() + offsets.size() + literals.size() >= blockSize) flush();
+  }
+  flush();
+
+  encode(0);
+  for(uint64_t n : range(end, beat.size())) write(beat[n]);
+  return output;
+}
+
+//creates a patch between raw CD-ROM images, diffing only the header and user data of each sector whose
+//EDC and parity verify (see Beat::Single::Sectors); apply() regenerates the rest in bulk
+//
+//"BPD1", target size, exception count, exception sector index deltas, target CRC32, and then
+//an ordinary patch between the stripped images, whose final checksum covers the whole patch
+inline auto createSectors(array_view<uint8_t> source, array_view<uint8_t> target, string_view manifest = {}) -> vector<uint8_t> {
+  vector<uint8_t> beat;
+
+  auto write = [&](uint8_t data) {
+    beat.append(data);
+  };
+
+  auto encode = [&](uint64_t data) {
+    while(true) {
+      uint64_t x = data & 0x7f;
+      data >>= 7;
+      if(data == 0) { write(0x80 | x); break; }
+      write(x);
+      data--;
+    }
+  };
+
+  vector<uint64_t> exceptions;
+  auto strippedSource = Sectors::strip(source);
+  auto strippedTarget = Sectors::strip(target, &exceptions);
+
+  write('B'), write('P'), write('D'), write('1');
+  encode(target.size()), encode(exceptions.size());
+  uint64_t next = 0;
+  for(auto index : exceptions) encode(index - next), next = index + 1;
+  auto targetHash = Hash::CRC32(target);
+  for(uint shift : range(0, 32, 8)) write(targetHash.value() >> shift);
+
+  auto patch = create(strippedSource, strippedTarget, manifest);
+  patch.resize(patch.size() - 4);
+  beat.append(patch);
+  auto beatHash = Hash::CRC32(beat);
+  for(uint shift : range(0, 32, 8)) write(beatHash.value() >> shift);
+
+  return beat;
+}
+
 }
@@ -0,0 +1,106 @@
+#pragma once
+
+//raw CD-ROM images of 2352-byte Mode 1 sectors are diffed with their derivable data removed:
+//the sync pattern, EDC, reserved bytes and RSPC parity of each sector are dropped, leaving its
+//header and user data, and are regenerated once the patch has been applied
+
+#include <nall/cd.hpp>
+#include <nall/parallel.hpp>
+
+namespace nall::Beat::Single::Sectors {
+
+enum : uint { SectorSize = 2352, StrippedSize = 2052, StrippedOffset = 12 };
+
+//a Mode 1 sector with a valid sync pattern: only its header and user data are diffed
+inline auto mode1(array_view<uint8_t> sector) -> bool {
+  return CD::Sync::verify(sector) && sector[15] == 0x01;
+}
+
+//a Mode 1 sector which is regenerated exactly from its header and user data
+inline auto regular(array_view<uint8_t> sector) -> bool {
+  if(!mode1(sector)) return false;
+  for(uint n : range(2068, 2076)) if(sector[n]) return false;
+  if(!CD::EDC::verifyMode1(sector)) return false;
+  uint8_t copy[SectorSize];
+  memory::copy(copy, sector.data(), SectorSize);
+  CD::RSPC::encodeMode1({copy, SectorSize});
+  return memory::compare(copy + 2076, sector.data() + 2076, SectorSize - 2076) == 0;
+}
+
+//strips each Mode 1 sector to its header and user data; other sectors, and any trailing partial sector, are kept whole.
+//given exceptions, only regular sectors are stripped, and the indices of all other sectors are listed there
+inline auto strip(array_view<uint8_t> image, vector<uint64_t>* exceptions = nullptr) -> vector<uint8_t> {
+  uint64_t sectors = image.size() / SectorSize;
+  vector<uint8_t> stripped;
+  stripped.resize(sectors * StrippedSize);
+  if(exceptions) exceptions->reset();
+
+  //verifying parity dominates, and is performed in parallel
+  vector<uint8_t> strippable;
+  strippable.resize(sectors);
+  parallel(sectors, [&](uint64_t index) {
+    array_view<uint8_t> sector{image.data() + index * SectorSize, SectorSize};
+    strippable[index] = exceptions ? regular(sector) : mode1(sector);
+  });
+
+  uint64_t offset = 0;
+  for(uint64_t index : range(sectors)) {
+    auto sector = image.data() + index * SectorSize;
+    if(strippable[index]) {
+      ::memcpy(stripped.data() + offset, sector + StrippedOffset, StrippedSize);
+      offset += StrippedSize;
+    } else {
+      if(exceptions) exceptions->append(index);
+      stripped.resize(stripped.size() + SectorSize - StrippedSize);
+      ::memcpy(stripped.data() + offset, sector, SectorSize);
+      offset += SectorSize;
+    }
+  }
+
+  uint64_t remaining = image.size() - sectors * SectorSize;
+  stripped.resize(offset + remaining);
+  ::memcpy(stripped.data() + offset, image.data() + sectors * SectorSize, remaining);
+  return stripped;
+}
+
+//rebuilds an image of size bytes from its stripped form, regenerating the sync pattern, EDC and parity
+//of every sector but the listed exceptions (which must be in ascending order)
+inline auto restore(array_view<uint8_t> stripped, const vector<uint64_t>& exceptions, uint64_t size) -> maybe<vector<uint8_t>> {
+  uint64_t sectors = size / SectorSize;
+  uint64_t remaining = size - sectors * SectorSize;
+  for(uint n : range(exceptions.size())) {
+    if(exceptions[n] >= sectors || (n && exceptions[n] <= exceptions[n - 1])) return nothing;
+  }
+  if(stripped.size() != sectors * StrippedSize + exceptions.size() * (SectorSize - StrippedSize) + remaining) return nothing;
+
+  vector<uint8_t> image;
+  image.resize(size);
+  vector<uint8_t> regenerate;
+  regenerate.resize(sectors);
+  uint64_t offset = 0, exception = 0;
+  for(uint64_t index : range(sectors)) {
+    auto sector = image.data() + index * SectorSize;
+    if(exception < exceptions.size() && exceptions[exception] == index) {
+      ::memcpy(sector, stripped.data() + offset, SectorSize);
+      offset += SectorSize;
+      exception++;
+    } else {
+      ::memcpy(sector + StrippedOffset, stripped.data() + offset, StrippedSize);
+      offset += StrippedSize;
+      regenerate[index] = 1;
+    }
+  }
+  ::memcpy(image.data() + sectors * SectorSize, stripped.data() + offset, remaining);
+
+  parallel(sectors, [&](uint64_t index) {
+    if(!regenerate[index]) return;
+    array_span<uint8_t> sector{image.data() + index * SectorSize, SectorSize};
+    CD::Sync::create(sector);
+    memory::fill<uint8_t>(sector.data() + 2068, 8);
+    CD::EDC::createMode1(sector);
+    CD::RSPC::encodeMode1(sector);
+  });
+  return image;
+}
+
+}
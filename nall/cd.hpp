@@ -8,6 +8,7 @@
  *   error detection code creation and verification
  *   reed-solomon product-code creation and verification
  *   sector scrambling and descrambling (currently unverified)
+ *   whole-disc image scanning and mode 1 sector repair
  *
  * Unimplemented:
  *    reed-solomon product-code correction
@@ -20,6 +21,7 @@
 
 #include <nall/galois-field.hpp>
 #include <nall/matrix.hpp>
+#include <nall/parallel.hpp>
 #include <nall/reed-solomon.hpp>
 
 #include <nall/cd/crc16.hpp>
@@ -29,3 +31,4 @@
 #include <nall/cd/rspc.hpp>
 #include <nall/cd/scrambler.hpp>
 #include <nall/cd/session.hpp>
+#include <nall/cd/scan.hpp>
@@ -1,17 +1,25 @@
 #pragma once
 
 //CRC-16/KERMIT
+//the table is generated at compile-time, and so may be shared between threads
 
 namespace nall::CD {
 
-inline auto CRC16(array_view<uint8_t> data) -> uint16_t {
-  uint16_t crc = 0;
-  while(data) {
-    crc ^= *data++ << 8;
-    for(uint bit : range(8)) {
-      crc = crc << 1 ^ (crc & 0x8000 ? 0x1021 : 0);
+inline constexpr struct CRC16Table {
+  constexpr CRC16Table() {
+    for(uint n = 0; n < 256; n++) {
+      uint16_t crc = n << 8;
+      for(uint bit = 0; bit < 8; bit++) crc = crc << 1 ^ (crc & 0x8000 ? 0x1021 : 0);
+      table[n] = crc;
     }
   }
+
+  uint16_t table[256] = {};
+} crc16Table;
+
+inline auto CRC16(array_view<uint8_t> data) -> uint16_t {
+  uint16_t crc = 0;
+  for(auto byte : data) crc = crc << 8 ^ crc16Table.table[(crc >> 8 ^ byte) & 0xff];
   return ~crc;
 }
 
@@ -5,24 +5,46 @@
 namespace nall::CD::EDC {
 
 //polynomial(x) = (x^16 + x^15 + x^2 + 1) * (x^16 + x^2 + x + 1)
-inline auto polynomial(uint8_t x) -> uint32_t {
-  static uint32_t lookup[256]{};
-  static bool once = false;
-  if(!once) { once = true;
-    for(uint n : range(256)) {
+//the tables are generated at compile-time, and so may be shared between threads:
+//table[0] advances the EDC by one byte; table[n] by one byte followed by n zero bytes (for slicing-by-8)
+inline constexpr struct Tables {
+  constexpr Tables() {
+    for(uint n = 0; n < 256; n++) {
       uint32_t edc = n;
-      for(uint b : range(8)) edc = edc >> 1 ^ (edc & 1 ? 0xd8018001 : 0);
-      lookup[n] = edc;
+      for(uint b = 0; b < 8; b++) edc = edc >> 1 ^ (edc & 1 ? 0xd8018001 : 0);
+      table[0][n] = edc;
+    }
+    for(uint n = 0; n < 256; n++) {
+      for(uint k = 1; k < 8; k++) table[k][n] = table[k - 1][n] >> 8 ^ table[0][table[k - 1][n] & 0xff];
     }
   }
-  return lookup[x];
+
+  uint32_t table[8][256] = {};
+} tables;
+
+inline auto polynomial(uint8_t x) -> uint32_t {
+  return tables.table[0][x];
 }
 
 //
 
 inline auto create(array_view<uint8_t> input) -> uint32_t {
   uint32_t sum = 0;
-  for(auto& byte : input) sum = sum >> 8 ^ polynomial(sum ^ byte);
+  auto data = input.data();
+  uint64_t size = input.size();
+  #if defined(ENDIAN_LSB)
+  auto& table = tables.table;
+  for(; size >= 8; data += 8, size -= 8) {
+    uint64_t word;
+    ::memcpy(&word, data, 8);
+    word ^= sum;
+    sum = table[7][word >>  0 & 0xff] ^ table[6][word >>  8 & 0xff]
+        ^ table[5][word >> 16 & 0xff] ^ table[4][word >> 24 & 0xff]
+        ^ table[3][word >> 32 & 0xff] ^ table[2][word >> 40 & 0xff]
+        ^ table[1][word >> 48 & 0xff] ^ table[0][word >> 56 & 0xff];
+  }
+  #endif
+  while(size--) sum = sum >> 8 ^ polynomial(sum ^ *data++);
   return sum;
 }
 
@@ -36,9 +58,14 @@ inline auto create(array_view<uint8_t> input, array_span<uint8_t> output) -> boo
   return true;
 }
 
-inline auto createMode1(array_span<uint8_t> sector) -> bool {
-  if(sector.size() != 2352) return false;
-  return create({sector, 2064}, {sector + 2064, 4});
+//accepts any number of contiguous sectors
+inline auto createMode1(array_span<uint8_t> sectors) -> bool {
+  if(!sectors.size() || sectors.size() % 2352) return false;
+  for(uint64_t offset = 0; offset < sectors.size(); offset += 2352) {
+    auto sector = sectors.data() + offset;
+    create({sector, 2064}, {sector + 2064, 4});
+  }
+  return true;
 }
 
 //
@@ -57,9 +84,24 @@ inline auto verify(array_view<uint8_t> input, array_view<uint8_t> compare) -> bo
   return true;
 }
 
-inline auto verifyMode1(array_view<uint8_t> sector) -> bool {
-  if(sector.size() != 2352) return false;
-  return verify({sector, 2064}, {sector + 2064, 4});
+//verifies any number of contiguous sectors, recording the result of each into valid (when given);
+//returns the number of sectors which verified
+inline auto verifyMode1(array_view<uint8_t> sectors, array_span<bool> valid) -> uint64_t {
+  if(sectors.size() % 2352) return 0;
+  uint64_t count = sectors.size() / 2352, verified = 0;
+  if(valid && valid.size() < count) return 0;
+  for(uint64_t index : range(count)) {
+    auto sector = sectors.data() + index * 2352;
+    bool result = verify({sector, 2064}, {sector + 2064, 4});
+    if(valid) valid[index] = result;
+    verified += result;
+  }
+  return verified;
+}
+
+inline auto verifyMode1(array_view<uint8_t> sectors) -> bool {
+  if(!sectors.size() || sectors.size() % 2352) return false;
+  return verifyMode1(sectors, array_span<bool>{}) == sectors.size() / 2352;
 }
 
 }
@@ -4,37 +4,37 @@
 
 namespace nall::CD::RSPC {
 
+//the P codewords are the columns of 24 rows of 86 bytes
 inline auto encodeP(array_view<uint8_t> input, array_span<uint8_t> parity) -> bool {
-  ReedSolomon<26,24> s;
-  uint lo = 0, hi = 43 * 2;
+  if(input.size() != 2064 || parity.size() != 172) return false;
+  const uint8_t* rows[24];
+  for(uint y : range(24)) rows[y] = input.data() + y * 86;
+  uint8_t* parities[2] = {parity.data(), parity.data() + 86};
+  ReedSolomon<26,24>::generateParity(rows, parities, 86);
+  return true;
+}
+
+//the Q codewords are the diagonals of 26 rows of 86 bytes, wrapping around: their symbols are gathered into rows
+inline auto gatherQ(const uint8_t* input, uint8_t (&diagonals)[43][52]) -> void {
   for(uint x : range(43)) {
-    for(uint w : range(2)) {  //16-bit words
-      uint z = 0;
-      for(uint y : range(24)) {
-        s[z++] = input[(y * 43 + x) * 2 + w];
-      }
-      s.generateParity();
-      parity[lo++] = s[z++];
-      parity[hi++] = s[z++];
+    uint offset = x * 44 * 2 % (26 * 43 * 2);
+    for(uint y : range(26)) {
+      diagonals[x][y * 2 + 0] = input[offset + 0];
+      diagonals[x][y * 2 + 1] = input[offset + 1];
+      offset += 43 * 2;
+      if(offset >= 26 * 43 * 2) offset -= 26 * 43 * 2;
     }
   }
-  return true;
 }
 
 inline auto encodeQ(array_view<uint8_t> input, array_span<uint8_t> parity) -> bool {
-  ReedSolomon<45,43> s;
-  uint lo = 0, hi = 26 * 2;
-  for(uint y : range(26)) {
-    for(uint w : range(2)) {
-      uint z = 0;
-      for(uint x : range(43)) {
-        s[z++] = input[((x * 44 + y * 43) * 2 + w) % (26 * 43 * 2)];
-      }
-      s.generateParity();
-      parity[lo++] = s[z++];
-      parity[hi++] = s[z++];
-    }
-  }
+  if(input.size() != 2236 || parity.size() != 104) return false;
+  uint8_t diagonals[43][52];
+  gatherQ(input.data(), diagonals);
+  const uint8_t* rows[43];
+  for(uint x : range(43)) rows[x] = diagonals[x];
+  uint8_t* parities[2] = {parity.data(), parity.data() + 52};
+  ReedSolomon<45,43>::generateParity(rows, parities, 52);
   return true;
 }
 
@@ -45,15 +45,36 @@ inline auto encodeMode1(array_span<uint8_t> sector) -> bool {
   return true;
 }
 
+//encodes the parity of every Mode 1 sector of a raw image, spread across threads; other sectors are left unchanged
+inline auto encodeImage(array_span<uint8_t> image, uint threads = 0) -> bool {
+  if(image.size() % 2352) return false;
+  parallel(image.size() / 2352, [&](uint64_t index) {
+    array_span<uint8_t> sector{image.data() + index * 2352, 2352};
+    if(!Sync::verify(sector) || sector[15] != 0x01) return;
+    encodeMode1(sector);
+  }, threads);
+  return true;
+}
+
 //
 
+//syndromes are first computed for all codewords at once, so that only those with errors are decoded individually
+
 inline auto decodeP(array_span<uint8_t> input, array_span<uint8_t> parity) -> int {
+  const uint8_t* rows[26];
+  for(uint y : range(24)) rows[y] = input.data() + y * 86;
+  rows[24] = parity.data(), rows[25] = parity.data() + 86;
+  uint8_t syndromes[2][86];
+  uint8_t* regions[2] = {syndromes[0], syndromes[1]};
+  ReedSolomon<26,24>::calculateSyndromes(rows, regions, 86);
+
   bool success = false;
   bool failure = false;
   ReedSolomon<26,24> s;
   uint lo = 0, hi = 43 * 2;
   for(uint x : range(43)) {
     for(uint w : range(2)) {
+      if(!syndromes[0][x * 2 + w] && !syndromes[1][x * 2 + w]) { lo++, hi++; continue; }
       uint z = 0;
       for(uint y : range(24)) {
         s[z++] = input[(y * 43 + x) * 2 + w];
@@ -80,12 +101,22 @@ inline auto decodeP(array_span<uint8_t> input, array_span<uint8_t> parity) -> in
 }
 
 inline auto decodeQ(array_span<uint8_t> input, array_span<uint8_t> parity) -> int {
+  uint8_t diagonals[43][52];
+  gatherQ(input.data(), diagonals);
+  const uint8_t* rows[45];
+  for(uint x : range(43)) rows[x] = diagonals[x];
+  rows[43] = parity.data(), rows[44] = parity.data() + 52;
+  uint8_t syndromes[2][52];
+  uint8_t* regions[2] = {syndromes[0], syndromes[1]};
+  ReedSolomon<45,43>::calculateSyndromes(rows, regions, 52);
+
   bool success = false;
   bool failure = false;
   ReedSolomon<45,43> s;
   uint lo = 0, hi = 26 * 2;
   for(uint y : range(26)) {
     for(uint w : range(2)) {
+      if(!syndromes[0][y * 2 + w] && !syndromes[1][y * 2 + w]) { lo++, hi++; continue; }
       uint z = 0;
       for(uint x : range(43)) {
         s[z++] = input[((x * 44 + y * 43) * 2 + w) % (26 * 43 * 2)];
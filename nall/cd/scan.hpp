@@ -0,0 +1,145 @@
+#pragma once
+
+//whole-disc image verification and repair:
+//sectors are partitioned across threads, and each is descrambled, verified, corrected,
+//and optionally written back, in a single pass over the image
+
+#include <nall/file.hpp>
+#include <nall/file-map.hpp>
+
+namespace nall::CD::Scan {
+
+enum class Status : uint {
+  Clean,      //mode 1 sector whose EDC verified
+  Corrected,  //mode 1 sector whose EDC verified after RSPC correction
+  Damaged,    //mode 1 sector that could not be corrected
+  Unchecked,  //audio, mode 0 and mode 2 sectors
+};
+
+struct Settings {
+  uint sectorSize = 2352;  //2352 (main channel only) or 2448 (followed by 96 bytes of P-W subchannel)
+  bool scrambled = false;  //sectors are stored as read from the disc, rather than descrambled
+  bool repair = false;     //write corrected sectors back into the image
+  uint threads = 0;        //0 = all processors
+};
+
+struct Damage {
+  uint64_t sector = 0;
+  Status status = Status::Unchecked;
+  bool subchannel = false;  //Q subchannel CRC16 mismatch
+};
+
+struct Report {
+  //true when every mode 1 sector verified (possibly after correction) and every Q subchannel checksum matched
+  explicit operator bool() const { return damaged == 0 && subchannelErrors == 0; }
+
+  uint64_t sectors = 0;
+  uint64_t clean = 0;
+  uint64_t corrected = 0;
+  uint64_t damaged = 0;
+  uint64_t unchecked = 0;
+  uint64_t subchannelErrors = 0;
+  vector<Damage> damage;   //every sector that was corrected or damaged, or had a subchannel error, in order
+  maybe<Session> session;  //decoded from the subchannel, when present and valid
+};
+
+//scans image in place: corrected sectors are only written back when settings.repair is set
+inline auto scan(array_span<uint8_t> image, const Settings& settings = {}) -> maybe<Report> {
+  uint size = settings.sectorSize;
+  if(size != 2352 && size != 2448) return nothing;
+  if(image.size() % size) return nothing;
+
+  Report report;
+  report.sectors = image.size() / size;
+
+  //each chunk of sectors keeps its own tallies, so that workers never contend
+  enum : uint { ChunkSize = 256 };
+  struct Chunk {
+    uint64_t tally[4] = {};
+    uint64_t subchannelErrors = 0;
+    vector<Damage> damage;
+  };
+  uint64_t chunks = (report.sectors + ChunkSize - 1) / ChunkSize;
+  vector<Chunk> results;
+  results.resize(chunks);
+
+  parallel(chunks, [&](uint64_t chunk) {
+    auto& result = results[chunk];
+    uint64_t first = chunk * ChunkSize;
+    uint64_t last = min(first + ChunkSize, report.sectors);
+    uint8_t sector[2352];
+    for(uint64_t index = first; index < last; index++) {
+      auto data = image.data() + index * size;
+      ::memcpy(sector, data, 2352);
+      if(settings.scrambled) Scrambler::transform({sector, 2352});
+
+      auto status = Status::Unchecked;
+      if(Sync::verify({sector, 2352}) && sector[15] == 0x01) {
+        if(EDC::verify({sector, 2064}, {sector + 2064, 4})) {
+          status = Status::Clean;
+        } else if(RSPC::decodeMode1({sector, 2352}) && EDC::verify({sector, 2064}, {sector + 2064, 4})) {
+          status = Status::Corrected;
+          if(settings.repair) {
+            if(settings.scrambled) Scrambler::transform({sector, 2352});
+            ::memcpy(data, sector, 2352);
+          }
+        } else {
+          status = Status::Damaged;
+        }
+      }
+      result.tally[(uint)status]++;
+
+      bool subchannel = false;
+      if(size == 2448) {
+        auto q = data + 2352 + 12;
+        auto crc16 = CRC16({q, 10});
+        subchannel = q[10] != uint8_t(crc16 >> 8) || q[11] != uint8_t(crc16 >> 0);
+        result.subchannelErrors += subchannel;
+      }
+
+      if(status == Status::Corrected || status == Status::Damaged || subchannel) {
+        result.damage.append({index, status, subchannel});
+      }
+    }
+  }, settings.threads);
+
+  for(auto& result : results) {
+    report.clean     += result.tally[(uint)Status::Clean];
+    report.corrected += result.tally[(uint)Status::Corrected];
+    report.damaged   += result.tally[(uint)Status::Damaged];
+    report.unchecked += result.tally[(uint)Status::Unchecked];
+    report.subchannelErrors += result.subchannelErrors;
+    for(auto& damage : result.damage) report.damage.append(damage);
+  }
+
+  if(size == 2448) {
+    Session session;
+    if(session.decode(image, 2448)) report.session = move(session);
+  }
+
+  return report;
+}
+
+//scans an image file through a memory map; when a target is given, the image is copied there first,
+//and corrected sectors are written back into the copy (a target naming the source repairs it in place)
+inline auto scanFile(const string& filename, Settings settings = {}, const string& target = {}) -> maybe<Report> {
+  if(!target) {
+    file_map map;
+    if(!map.open(filename, file_map::mode::read)) return nothing;
+    settings.repair = false;
+    return scan({map.data(), map.size()}, settings);
+  }
+
+  if(target != filename) {
+    file_map source;
+    if(!source.open(filename, file_map::mode::read)) return nothing;
+    if(!file::write(target, {source.data(), source.size()})) return nothing;
+  }
+
+  file_map map;
+  if(!map.open(target, file_map::mode::modify)) return nothing;
+  settings.repair = true;
+  return scan({map.data(), map.size()}, settings);
+}
+
+}
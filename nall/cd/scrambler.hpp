@@ -3,20 +3,23 @@
 namespace nall::CD::Scrambler {
 
 //polynomial(x) = x^15 + x + 1
-inline auto polynomial(uint x) -> uint8_t {
-  static uint8_t lookup[2340]{};
-  static bool once = false;
-  if(!once) { once = true;
+inline constexpr struct Lookup {
+  constexpr Lookup() {
     uint16_t shift = 0x0001;
-    for(uint n : range(2340)) {
-      lookup[n] = shift;
-      for(uint b : range(8)) {
+    for(uint n = 0; n < 2340; n++) {
+      table[n] = shift;
+      for(uint b = 0; b < 8; b++) {
         bool carry = shift & 1 ^ shift >> 1 & 1;
         shift = (carry << 15 | shift) >> 1;
       }
     }
   }
-  return lookup[x];
+
+  uint8_t table[2340] = {};
+} lookup;
+
+inline auto polynomial(uint x) -> uint8_t {
+  return lookup.table[x];
 }
 
 //
@@ -25,8 +28,14 @@ inline auto transform(array_span<uint8_t> sector) -> bool {
   if(sector.size() == 2352) sector += 12;  //header is not scrambled
   if(sector.size() != 2340) return false;  //F1 frames only
 
-  for(uint index : range(2340)) {
-    sector[index] ^= polynomial(index);
+  //2340 is a multiple of four, so the sector is transformed a word at a time
+  auto data = sector.data();
+  for(uint index = 0; index < 2340; index += 4) {
+    uint32_t word, mask;
+    ::memcpy(&word, data + index, 4);
+    ::memcpy(&mask, lookup.table + index, 4);
+    word ^= mask;
+    ::memcpy(data + index, &word, 4);
   }
 
   return true;
@@ -1,7 +1,18 @@
 #pragma once
 
 #include <nall/arithmetic.hpp>
+#include <nall/array-span.hpp>
 #include <nall/array-view.hpp>
+#include <nall/cpu.hpp>
+
+#if defined(ARCHITECTURE_AMD64)
+  #define NALL_CHACHA20_SSE2
+  #include <emmintrin.h>
+  #if defined(COMPILER_GCC) || defined(COMPILER_CLANG)
+    #define NALL_CHACHA20_AVX2
+    #include <immintrin.h>
+  #endif
+#endif
 
 namespace nall::Cipher {
 
@@ -32,15 +43,8 @@ struct ChaCha20 {
 
   auto encrypt(array_view<uint8_t> input) -> vector<uint8_t> {
     vector<uint8_t> output;
-    while(input) {
-      if(!offset) {
-        cipher();
-        increment();
-      }
-      auto byte = offset++;
-      output.append(*input++ ^ (block[byte >> 2] >> (byte & 3) * 8));
-      offset &= 63;
-    }
+    output.resize(input.size());
+    process(input.data(), output.data(), input.size());
     return output;
   }
 
@@ -48,6 +52,47 @@ struct ChaCha20 {
     return encrypt(input);  //reciprocal cipher
   }
 
+  //streaming interface: output must be at least as large as input, and may alias it
+  //successive calls continue the keystream where the previous call left off
+  auto encrypt(array_view<uint8_t> input, array_span<uint8_t> output) -> void {
+    process(input.data(), output.data(), min(input.size(), output.size()));
+  }
+
+  auto decrypt(array_view<uint8_t> input, array_span<uint8_t> output) -> void {
+    return encrypt(input, output);  //reciprocal cipher
+  }
+
+  auto process(const uint8_t* source, uint8_t* target, uint64_t size) -> void {
+    //consume any keystream left over from the previous call
+    while(offset && size) {
+      *target++ = *source++ ^ block[offset >> 2] >> (offset & 3) * 8;
+      offset = offset + 1 & 63;
+      size--;
+    }
+
+    #if defined(NALL_CHACHA20_AVX2)
+    if(CPU::features().avx2) bulk<8>(blocksAVX2, source, target, size);
+    #endif
+    #if defined(NALL_CHACHA20_SSE2)
+    bulk<4>(blocksSSE2, source, target, size);
+    #endif
+
+    uint8_t keystream[64];
+    while(size) {
+      cipher();
+      increment();
+      for(uint n : range(16)) {
+        for(uint byte : range(4)) keystream[n * 4 + byte] = block[n] >> byte * 8;
+      }
+      uint length = min(size, 64);
+      combine(source, target, keystream, length);
+      source += length;
+      target += length;
+      size -= length;
+      offset = length & 63;
+    }
+  }
+
 //protected:
   inline auto rol(uint32_t value, uint bits) -> uint32_t {
     return value << bits | value >> 32 - bits;
@@ -81,6 +126,127 @@ struct ChaCha20 {
     if(!++input[12]) ++input[13];
   }
 
+  //target = source ^ keystream
+  static auto combine(const uint8_t* source, uint8_t* target, const uint8_t* keystream, uint size) -> void {
+    uint n = 0;
+    for(; n + 8 <= size; n += 8) {
+      uint64_t x, y;
+      ::memcpy(&x, source + n, 8);
+      ::memcpy(&y, keystream + n, 8);
+      x ^= y;
+      ::memcpy(target + n, &x, 8);
+    }
+    for(; n < size; n++) target[n] = source[n] ^ keystream[n];
+  }
+
+  //processes as many whole groups of Blocks keystream blocks as will fit
+  template<uint Blocks, typename F> auto bulk(const F& blocks, const uint8_t*& source, uint8_t*& target, uint64_t& size) -> void {
+    alignas(32) uint8_t keystream[Blocks * 64];
+    while(size >= Blocks * 64) {
+      uint64_t counter = input[12] | (uint64_t)input[13] << 32;
+      blocks(input, counter, keystream);
+      counter += Blocks;
+      input[12] = counter >>  0;
+      input[13] = counter >> 32;
+      combine(source, target, keystream, Blocks * 64);
+      source += Blocks * 64;
+      target += Blocks * 64;
+      size -= Blocks * 64;
+    }
+  }
+
+  #if defined(NALL_CHACHA20_SSE2)
+  //four blocks in parallel: each vector holds the same state word of four consecutive blocks
+  static auto blocksSSE2(const uint32_t input[16], uint64_t counter, uint8_t* output) -> void {
+    #define rotate(x, n) _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n))
+    #define quarter(a, b, c, d) \
+      x[a] = _mm_add_epi32(x[a], x[b]); x[d] = rotate(_mm_xor_si128(x[d], x[a]), 16); \
+      x[c] = _mm_add_epi32(x[c], x[d]); x[b] = rotate(_mm_xor_si128(x[b], x[c]), 12); \
+      x[a] = _mm_add_epi32(x[a], x[b]); x[d] = rotate(_mm_xor_si128(x[d], x[a]),  8); \
+      x[c] = _mm_add_epi32(x[c], x[d]); x[b] = rotate(_mm_xor_si128(x[b], x[c]),  7);
+    __m128i x[16], y[16];
+    for(uint n : range(16)) y[n] = _mm_set1_epi32(input[n]);
+    y[12] = _mm_set_epi32(counter + 3, counter + 2, counter + 1, counter + 0);
+    y[13] = _mm_set_epi32((counter + 3) >> 32, (counter + 2) >> 32, (counter + 1) >> 32, (counter + 0) >> 32);
+    for(uint n : range(16)) x[n] = y[n];
+    for(uint n : range(10)) {
+      quarter(0, 4,  8, 12);
+      quarter(1, 5,  9, 13);
+      quarter(2, 6, 10, 14);
+      quarter(3, 7, 11, 15);
+      quarter(0, 5, 10, 15);
+      quarter(1, 6, 11, 12);
+      quarter(2, 7,  8, 13);
+      quarter(3, 4,  9, 14);
+    }
+    #undef quarter
+    #undef rotate
+    for(uint n : range(16)) x[n] = _mm_add_epi32(x[n], y[n]);
+    //transpose each 4x4 group of words back into block order
+    for(uint g : range(4)) {
+      __m128i a = _mm_unpacklo_epi32(x[g * 4 + 0], x[g * 4 + 1]);
+      __m128i b = _mm_unpacklo_epi32(x[g * 4 + 2], x[g * 4 + 3]);
+      __m128i c = _mm_unpackhi_epi32(x[g * 4 + 0], x[g * 4 + 1]);
+      __m128i d = _mm_unpackhi_epi32(x[g * 4 + 2], x[g * 4 + 3]);
+      _mm_storeu_si128((__m128i*)(output + 0 * 64 + g * 16), _mm_unpacklo_epi64(a, b));
+      _mm_storeu_si128((__m128i*)(output + 1 * 64 + g * 16), _mm_unpackhi_epi64(a, b));
+      _mm_storeu_si128((__m128i*)(output + 2 * 64 + g * 16), _mm_unpacklo_epi64(c, d));
+      _mm_storeu_si128((__m128i*)(output + 3 * 64 + g * 16), _mm_unpackhi_epi64(c, d));
+    }
+  }
+  #endif
+
+  #if defined(NALL_CHACHA20_AVX2)
+  //eight blocks in parallel; same layout as blocksSSE2() with blocks 4-7 in the upper lanes
+  __attribute__((target("avx2"))) static auto blocksAVX2(const uint32_t input[16], uint64_t counter, uint8_t* output) -> void {
+    const __m256i rotate16 = _mm256_set_epi8(
+      13,12,15,14, 9,8,11,10, 5,4,7,6, 1,0,3,2, 13,12,15,14, 9,8,11,10, 5,4,7,6, 1,0,3,2);
+    const __m256i rotate8 = _mm256_set_epi8(
+      14,13,12,15, 10,9,8,11, 6,5,4,7, 2,1,0,3, 14,13,12,15, 10,9,8,11, 6,5,4,7, 2,1,0,3);
+    #define rotate(x, n) _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n))
+    #define quarter(a, b, c, d) \
+      x[a] = _mm256_add_epi32(x[a], x[b]); x[d] = _mm256_shuffle_epi8(_mm256_xor_si256(x[d], x[a]), rotate16); \
+      x[c] = _mm256_add_epi32(x[c], x[d]); x[b] = rotate(_mm256_xor_si256(x[b], x[c]), 12); \
+      x[a] = _mm256_add_epi32(x[a], x[b]); x[d] = _mm256_shuffle_epi8(_mm256_xor_si256(x[d], x[a]), rotate8); \
+      x[c] = _mm256_add_epi32(x[c], x[d]); x[b] = rotate(_mm256_xor_si256(x[b], x[c]),  7);
+    __m256i x[16], y[16];
+    for(uint n : range(16)) y[n] = _mm256_set1_epi32(input[n]);
+    uint32_t lo[8], hi[8];
+    for(uint n : range(8)) lo[n] = counter + n, hi[n] = counter + n >> 32;
+    //lane order 0,1,2,3 | 4,5,6,7 so that the 128-bit halves transpose independently
+    y[12] = _mm256_loadu_si256((const __m256i*)lo);
+    y[13] = _mm256_loadu_si256((const __m256i*)hi);
+    for(uint n : range(16)) x[n] = y[n];
+    for(uint n : range(10)) {
+      quarter(0, 4,  8, 12);
+      quarter(1, 5,  9, 13);
+      quarter(2, 6, 10, 14);
+      quarter(3, 7, 11, 15);
+      quarter(0, 5, 10, 15);
+      quarter(1, 6, 11, 12);
+      quarter(2, 7,  8, 13);
+      quarter(3, 4,  9, 14);
+    }
+    #undef quarter
+    #undef rotate
+    for(uint n : range(16)) x[n] = _mm256_add_epi32(x[n], y[n]);
+    for(uint g : range(4)) {
+      __m256i a = _mm256_unpacklo_epi32(x[g * 4 + 0], x[g * 4 + 1]);
+      __m256i b = _mm256_unpacklo_epi32(x[g * 4 + 2], x[g * 4 + 3]);
+      __m256i c = _mm256_unpackhi_epi32(x[g * 4 + 0], x[g * 4 + 1]);
+      __m256i d = _mm256_unpackhi_epi32(x[g * 4 + 2], x[g * 4 + 3]);
+      __m256i rows[4] = {
+        _mm256_unpacklo_epi64(a, b), _mm256_unpackhi_epi64(a, b),
+        _mm256_unpacklo_epi64(c, d), _mm256_unpackhi_epi64(c, d),
+      };
+      for(uint r : range(4)) {
+        _mm_storeu_si128((__m128i*)(output + (r + 0) * 64 + g * 16), _mm256_castsi256_si128(rows[r]));
+        _mm_storeu_si128((__m128i*)(output + (r + 4) * 64 + g * 16), _mm256_extracti128_si256(rows[r], 1));
+      }
+    }
+  }
+  #endif
+
   uint32_t input[16];
   uint32_t block[16];
   uint64_t offset;
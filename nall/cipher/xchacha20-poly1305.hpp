@@ -0,0 +1,120 @@
+#pragma once
+
+#include <nall/literals.hpp>
+#include <nall/parallel.hpp>
+#include <nall/cipher/chacha20.hpp>
+#include <nall/mac/poly1305.hpp>
+
+namespace nall::Cipher {
+
+//chunked XChaCha20-Poly1305 authenticated encryption:
+//the plaintext is split into fixed-size chunks, each sealed as ciphertext followed by a 16-byte tag,
+//so that chunks can be authenticated and decrypted independently (and in parallel).
+//
+//chunk n uses the XChaCha20 keystream from block n * (chunkSize / 64 + 1):
+//the first block supplies the one-time Poly1305 key, and the following blocks encrypt the chunk.
+//each tag covers (as in RFC 8439) eight bytes of associated data holding the chunk index, with bit 63 set
+//on the final chunk, followed by the ciphertext: chunks cannot be reordered, and the sealed data cannot be
+//truncated at a chunk boundary.
+struct XChaCha20Poly1305 {
+  enum : uint { TagSize = 16 };
+
+  //chunkSize must be a non-zero multiple of 64
+  XChaCha20Poly1305(uint256_t key, uint192_t nonce, uint64_t chunkSize = 64_KiB) :
+  key(HChaCha20(key, nonce).key()), nonce(nonce >> 128), chunkSize(chunkSize) {
+  }
+
+  auto valid() const -> bool {
+    return chunkSize && chunkSize % 64 == 0;
+  }
+
+  auto chunks(uint64_t plaintextSize) const -> uint64_t {
+    return max<uint64_t>(1, (plaintextSize + chunkSize - 1) / chunkSize);
+  }
+
+  auto sealedSize(uint64_t plaintextSize) const -> uint64_t {
+    return plaintextSize + chunks(plaintextSize) * TagSize;
+  }
+
+  auto seal(array_view<uint8_t> plaintext, uint threads = 0) const -> vector<uint8_t> {
+    vector<uint8_t> sealed;
+    if(!valid()) return sealed;
+    uint64_t count = chunks(plaintext.size());
+    sealed.resize(sealedSize(plaintext.size()));
+    parallel(count, [&](uint64_t index) {
+      uint64_t offset = index * chunkSize;
+      uint64_t length = min(chunkSize, plaintext.size() - offset);
+      auto target = sealed.data() + index * (chunkSize + TagSize);
+      auto cipher = stream(index);
+      cipher.process(plaintext.data() + offset, target, length);
+      auto tag = authenticate(index, index + 1 == count, target, length);
+      for(uint byte : range(TagSize)) target[length + byte] = tag >> byte * 8;
+    }, threads);
+    return sealed;
+  }
+
+  //fails (returning nothing) if the data is malformed, or if any chunk fails to authenticate;
+  //once a chunk has failed, chunks that have not yet been started are skipped
+  auto open(array_view<uint8_t> sealed, uint threads = 0) const -> maybe<vector<uint8_t>> {
+    if(!valid() || sealed.size() < TagSize) return nothing;
+    uint64_t stride = chunkSize + TagSize;
+    uint64_t count = (sealed.size() + stride - 1) / stride;
+    if(sealed.size() - (count - 1) * stride < TagSize) return nothing;
+
+    vector<uint8_t> plaintext;
+    plaintext.resize(sealed.size() - count * TagSize);
+    std::atomic<bool> authentic{true};
+    parallel(count, [&](uint64_t index) {
+      if(!authentic) return;
+      uint64_t length = min(chunkSize, plaintext.size() - index * chunkSize);
+      auto source = sealed.data() + index * stride;
+      auto tag = authenticate(index, index + 1 == count, source, length);
+      //constant-time comparison
+      uint8_t difference = 0;
+      for(uint byte : range(TagSize)) difference |= source[length + byte] ^ uint8_t(tag >> byte * 8);
+      if(difference) { authentic = false; return; }
+      auto cipher = stream(index);
+      cipher.process(source, plaintext.data() + index * chunkSize, length);
+    }, threads);
+    if(!authentic) return nothing;
+    return plaintext;
+  }
+
+private:
+  //the keystream for a chunk's data begins just after the block that supplies its Poly1305 key
+  auto stream(uint64_t index) const -> ChaCha20 {
+    return {key, nonce, index * (chunkSize / 64 + 1) + 1};
+  }
+
+  auto authenticate(uint64_t index, bool final, const uint8_t* ciphertext, uint64_t length) const -> uint128_t {
+    uint8_t block[64] = {};
+    ChaCha20 cipher{key, nonce, index * (chunkSize / 64 + 1)};
+    cipher.process(block, block, 64);
+    uint256_t oneTimeKey = 0;
+    for(uint byte : reverse(range(32))) oneTimeKey = oneTimeKey << 8 | block[byte];
+
+    //associated data and ciphertext are each zero-padded to 16 bytes, then followed by their lengths
+    uint8_t padding[16] = {};
+    uint8_t associated[16] = {};
+    uint8_t lengths[16] = {};
+    for(uint byte : range(8)) {
+      associated[byte] = (index | (uint64_t)final << 63) >> byte * 8;
+      lengths[0 + byte] = (uint64_t)8 >> byte * 8;
+      lengths[8 + byte] = length >> byte * 8;
+    }
+
+    MAC::Poly1305 poly1305;
+    poly1305.initialize(oneTimeKey);
+    poly1305.process(associated, 16);
+    poly1305.process(ciphertext, length);
+    if(length & 15) poly1305.process(padding, 16 - (length & 15));
+    poly1305.process(lengths, 16);
+    return poly1305.finish();
+  }
+
+  const uint256_t key;
+  const uint64_t nonce;
+  const uint64_t chunkSize;
+};
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+//runtime processor feature detection
+//used to select accelerated code paths that cannot be enabled at compile-time
+//without breaking compatibility with older processors
+
+#include <nall/intrinsics.hpp>
+#include <nall/stdint.hpp>
+
+#if defined(ARCHITECTURE_X86) || defined(ARCHITECTURE_AMD64)
+  #if defined(COMPILER_MICROSOFT)
+    #include <intrin.h>
+  #else
+    #include <cpuid.h>
+  #endif
+#endif
+
+namespace nall::CPU {
+
+struct Features {
+  bool sse2 = false;
+  bool ssse3 = false;
+  bool sse41 = false;
+  bool pclmul = false;
+  bool avx2 = false;
+  bool bmi2 = false;
+  bool adx = false;
+  bool sha = false;
+};
+
+inline auto detect() -> Features {
+  Features features;
+  #if defined(ARCHITECTURE_X86) || defined(ARCHITECTURE_AMD64)
+  auto cpuid = [](uint leaf, uint subleaf, uint32_t (&registers)[4]) -> void {
+    #if defined(COMPILER_MICROSOFT)
+    int result[4];
+    __cpuidex(result, leaf, subleaf);
+    for(uint n = 0; n < 4; n++) registers[n] = result[n];
+    #else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+    #endif
+  };
+
+  uint32_t registers[4] = {};
+  cpuid(0, 0, registers);
+  uint32_t maximum = registers[0];
+  if(maximum < 1) return features;
+
+  cpuid(1, 0, registers);
+  features.sse2   = registers[3] & 1 << 26;
+  features.ssse3  = registers[2] & 1 <<  9;
+  features.sse41  = registers[2] & 1 << 19;
+  features.pclmul = registers[2] & 1 <<  1;
+  bool osxsave    = registers[2] & 1 << 27;
+  bool avx        = registers[2] & 1 << 28;
+
+  //AVX state must also be enabled by the operating system
+  bool ymm = false;
+  if(osxsave && avx) {
+    #if defined(COMPILER_MICROSOFT)
+    ymm = (_xgetbv(0) & 6) == 6;
+    #else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    ymm = (lo & 6) == 6;
+    #endif
+  }
+
+  if(maximum < 7) return features;
+  cpuid(7, 0, registers);
+  features.avx2 = ymm && registers[1] & 1 <<  5;
+  features.bmi2 = registers[1] & 1 <<  8;
+  features.adx  = registers[1] & 1 << 19;
+  features.sha  = registers[1] & 1 << 29;
+  #endif
+  return features;
+}
+
+//detection is performed once; thread-safe via static initialization
+inline auto features() -> const Features& {
+  static const Features features = detect();
+  return features;
+}
+
+}
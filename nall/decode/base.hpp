@@ -1,6 +1,7 @@
 #pragma once
 
 #include <nall/arithmetic.hpp>
+#include <nall/array.hpp>
 
 namespace nall::Decode {
 
@@ -18,19 +19,24 @@ template<uint Bits, typename T> inline auto Base(const string& value) -> T {
   : Bits == 64 ? "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz{}"
   : Bits == 85 ? "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz!#$%()+,-.:;=@[]^_`{|}~"  //\ "&'*/<>?
   : "";
-  static bool initialized = false;
-  static uint8_t lookup[256] = {0};
-  if(!initialized) {
-    initialized = true;
-    for(uint n : range(format.size())) {
-      lookup[format[n]] = n;
-    }
-  }
+  static const auto lookup = [] {
+    array<uint8_t[256]> lookup{};
+    for(uint n : range(format.size())) lookup[(uint8_t)format[n]] = n;
+    return lookup;
+  }();
 
+  //digits are gathered natively while they fit in 64 bits, so that wide types need far fewer multiplications
   T result = 0;
+  uint64_t digits = 0, scale = 1;
   for(auto byte : value) {
-    result = result * Bits + lookup[byte];
+    digits = digits * Bits + lookup[(uint8_t)byte];
+    scale *= Bits;
+    if(scale > ~0ull / Bits) {
+      result = result * scale + digits;
+      digits = 0, scale = 1;
+    }
   }
+  if(scale > 1) result = result * scale + digits;
   return result;
 }
 
@@ -17,6 +17,7 @@ inline auto Base64(const string& text) -> vector<uint8_t> {
   vector<uint8_t> result;
   uint8_t buffer, output;
   for(uint n : range(text.size())) {
+    if(text[n] == '=') break;  //padding
     uint8_t buffer = lookup[text[n]];
 
     switch(n & 3) {
@@ -40,7 +41,7 @@ inline auto Base64(const string& text) -> vector<uint8_t> {
     }
   }
 
-  if(text.size() & 3) result.append(output | buffer);
+  //any bits remaining in output are padding
   return result;
 }
 
@@ -1,44 +1,52 @@
 #pragma once
 
 //burrows-wheeler transform
-
-#include <nall/suffix-array.hpp>
+//the first column of the sorted rotations is the last column in sorted order, and so it follows
+//from the symbol counts alone: each rotation is linked to its successor with one counting sort,
+//and the input is then recovered by following the links, in O(n)
 
 namespace nall::Decode {
 
 inline auto BWT(array_view<uint8_t> input) -> vector<uint8_t> {
   vector<uint8_t> output;
 
-  uint size = 0;
-  for(uint byte : range(8)) size |= *input++ << byte * 8;
-  output.resize(size);
-
-  uint I = 0;
-  for(uint byte : range(8)) I |= *input++ << byte * 8;
-
-  auto suffixes = SuffixArray(input);
-
-  auto L = input;
-  auto F = new uint8_t[size];
-  for(uint offset : range(size)) F[offset] = L[suffixes[offset + 1]];
-
-  uint64_t K[256] = {};
-  auto C = new int[size];
-  for(uint i : range(size)) {
-    C[i] = K[L[i]];
-    K[L[i]]++;
+  uint64_t size = 0;
+  for(uint byte : range(8)) size |= (uint64_t)input(byte) << byte * 8;
+  uint64_t primary = 0;
+  for(uint byte : range(8)) primary |= (uint64_t)input(8 + byte) << byte * 8;
+  input += 16;
+  if(size != input.size() || primary > size || size >= 1ull << 32) return output;
+
+  //the last column has size + 1 rows: row primary holds the sentinel, which is not stored
+  auto L = input.data();
+  auto symbol = [&](uint64_t row) -> uint8_t { return L[row - (row > primary)]; };
+
+  //rows beginning with each symbol start after the sentinel row and all rows of smaller symbols
+  uint64_t C[256] = {};
+  for(uint64_t offset : range(size)) C[L[offset]]++;
+  uint64_t total = 1;
+  for(uint n : range(256)) {
+    uint64_t count = C[n];
+    C[n] = total;
+    total += count;
   }
 
-  int M[256];
-  memory::fill<int>(M, 256, -1);
-  for(uint i : range(size)) {
-    if(M[F[i]] == -1) M[F[i]] = i;
+  //next[row] is the row of the rotation starting one symbol later: the kth occurrence of a symbol
+  //in the last column precedes the kth row beginning with that symbol
+  vector<uint32_t> next;
+  next.resize(size + 1);
+  next[0] = primary;
+  for(uint64_t row : range(size + 1)) {
+    if(row == primary) continue;
+    next[C[symbol(row)]++] = row;
   }
 
-  uint i = I;
-  for(uint j : reverse(range(size))) {
-    output[j] = L[i];
-    i = C[i] + M[L[i]];
+  //the rotation beginning with the input is the one ending with the sentinel
+  output.resize(size);
+  uint32_t row = primary;
+  for(uint64_t offset : range(size)) {
+    row = next[row];
+    output[offset] = symbol(row);
   }
 
   return output;
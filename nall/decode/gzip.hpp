@@ -1,7 +1,9 @@
 #pragma once
 
 #include <nall/file.hpp>
+#include <nall/shared-pointer.hpp>
 #include <nall/decode/inflate.hpp>
+#include <nall/hash/crc32.hpp>
 
 namespace nall::Decode {
 
@@ -10,6 +12,8 @@ struct GZIP {
 
   inline auto decompress(const string& filename) -> bool;
   inline auto decompress(const uint8_t* data, uint size) -> bool;
+  inline auto stream(const uint8_t* data, uint64_t size, maybe<bool&> intact = {}) -> Inflate::Reader;
+  inline auto header(const uint8_t* data, uint64_t size) -> uint64_t;
 
   string filename;
   uint8_t* data = nullptr;
@@ -28,9 +32,52 @@ auto GZIP::decompress(const string& filename) -> bool {
 }
 
 auto GZIP::decompress(const uint8_t* data, uint size) -> bool {
-  if(size < 18) return false;
-  if(data[0] != 0x1f) return false;
-  if(data[1] != 0x8b) return false;
+  uint p = header(data, size);
+  if(!p) return false;
+  uint isize = data[size - 4];
+  isize |= data[size - 3] << 8;
+  isize |= data[size - 2] << 16;
+  isize |= data[size - 1] << 24;
+
+  this->size = isize;
+  this->data = new uint8_t[this->size];
+  return inflate(this->data, this->size, data + p, size - p - 8);
+}
+
+//returns a reader that yields the decompressed contents in chunks as they are requested;
+//data must remain valid for as long as the reader is in use.
+//once the reader has returned an empty chunk, intact is set to whether the stream ended where it should,
+//and matched the CRC32 and size in the trailer: a corrupt or truncated stream otherwise looks like a clean end
+auto GZIP::stream(const uint8_t* data, uint64_t size, maybe<bool&> intact) -> Inflate::Reader {
+  uint64_t p = header(data, size);
+  if(!p) return {};
+  array_view<uint8_t> compressed{data + p, size - p - 8};
+  array_view<uint8_t> trailer{data + size - 8, 8};
+  bool pending = true;
+  shared_pointer<Inflate> inflate = new Inflate;
+  inflate->open([=]() mutable -> array_view<uint8_t> {
+    if(!pending) return {};
+    return pending = false, compressed;
+  });
+  Hash::CRC32 crc32;
+  uint32_t isize = 0;
+  return [=]() mutable -> array_view<uint8_t> {
+    auto chunk = inflate->next();
+    if(chunk) {
+      crc32.input(chunk);
+      isize += chunk.size();
+    } else if(intact) {
+      intact() = inflate->finished() && crc32.value() == trailer.readl<uint32_t>(0, 4) && isize == trailer.readl<uint32_t>(4, 4);
+    }
+    return chunk;
+  };
+}
+
+//parses the member header; returns the offset of the compressed data, or 0 if the header is invalid
+auto GZIP::header(const uint8_t* data, uint64_t size) -> uint64_t {
+  if(size < 18) return 0;
+  if(data[0] != 0x1f) return 0;
+  if(data[1] != 0x8b) return 0;
   uint cm = data[2];
   uint flg = data[3];
   uint mtime = data[4];
@@ -39,11 +86,7 @@ auto GZIP::decompress(const uint8_t* data, uint size) -> bool {
   mtime |= data[7] << 24;
   uint xfl = data[8];
   uint os = data[9];
-  uint p = 10;
-  uint isize = data[size - 4];
-  isize |= data[size - 3] << 8;
-  isize |= data[size - 2] << 16;
-  isize |= data[size - 1] << 24;
+  uint64_t p = 10;
   filename = "";
 
   if(flg & 0x04) {  //FEXTRA
@@ -58,7 +101,7 @@ auto GZIP::decompress(const uint8_t* data, uint size) -> bool {
       buffer[n] = data[p];
       if(data[p] == 0) break;
     }
-    if(data[p++]) return false;
+    if(data[p++]) return 0;
     filename = buffer;
   }
 
@@ -70,9 +113,8 @@ auto GZIP::decompress(const uint8_t* data, uint size) -> bool {
     p += 2;
   }
 
-  this->size = isize;
-  this->data = new uint8_t[this->size];
-  return inflate(this->data, this->size, data + p, size - p - 8);
+  if(p + 8 > size) return 0;
+  return p;
 }
 
 }
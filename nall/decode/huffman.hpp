@@ -1,35 +1,178 @@
 #pragma once
 
+//canonical codes are decoded through a lookup table indexed by the next TableBits of input,
+//where each entry yields up to two symbols; codes longer than that are decoded a bit at a time
+
 namespace nall::Decode {
 
 inline auto Huffman(array_view<uint8_t> input) -> vector<uint8_t> {
   vector<uint8_t> output;
+  if(input.size() < 8) return output;
+
+  uint64_t size = 0;
+  for(uint byte : range(8)) size |= (uint64_t)*input++ << byte * 8;
+
+  //every symbol occupies at least one bit
+  if((size & ~(1ull << 63)) > input.size() * 8) return output;
+
+  //original format: an explicit code tree, walked one bit at a time
+  if(!(size >> 63)) {
+    output.reserve(size);
+
+    uint64_t position = 0;
+    uint byte = 0, bits = 0;
+    auto read = [&]() -> bool {
+      if(bits == 0) bits = 8, byte = input(position++);
+      return byte >> --bits & 1;
+    };
+
+    uint nodes[256][2] = {};
+    for(uint offset : range(256)) {
+      for(uint index : range(9)) nodes[offset][0] = nodes[offset][0] << 1 | read();
+      for(uint index : range(9)) nodes[offset][1] = nodes[offset][1] << 1 | read();
+    }
+
+    uint node = 511;
+    while(output.size() < size) {
+      if(position > input.size()) return {};
+      node = nodes[node - 256][read()];
+      if(node < 256) {
+        output.append(node);
+        node = 511;
+      }
+    }
+
+    return output;
+  }
+
+  size &= ~(1ull << 63);
+  if(input.size() < 128) return {};
+  uint8_t lengths[256];
+  for(uint n : range(128)) {
+    lengths[n * 2 + 0] = input[n] & 15;
+    lengths[n * 2 + 1] = input[n] >> 4;
+  }
+  input += 128;
 
-  uint size = 0;
-  for(uint byte : range(8)) size |= *input++ << byte * 8;
-  output.reserve(size);
+  //canonical code ranges: symbols sorted by code length, then by value
+  uint counts[16] = {}, offsets[16] = {};
+  uint8_t symbols[256];
+  for(uint n : range(256)) counts[lengths[n]]++;
+  counts[0] = 0;
+  uint64_t kraft = 0;
+  for(uint bits : range(1, 16)) {
+    offsets[bits] = offsets[bits - 1] + counts[bits - 1];
+    kraft += (uint64_t)counts[bits] << 15 - bits;
+  }
+  if(kraft > 1 << 15) return {};
+  for(uint n : range(256)) if(lengths[n]) symbols[offsets[lengths[n]]++] = n;
 
-  uint byte = 0, bits = 0;
-  auto read = [&]() -> bool {
-    if(bits == 0) bits = 8, byte = *input++;
-    return byte >> --bits & 1;
+  //entries: first symbol:8, second symbol:8, symbol count:2, first length:4, total length:5
+  //a symbol count of zero indicates a code longer than TableBits (or an invalid code)
+  enum : uint { TableBits = 11, TableSize = 1 << TableBits };
+  uint16_t single[TableSize] = {};
+  uint next[16] = {};
+  for(uint bits : range(1, 16)) next[bits] = next[bits - 1] + counts[bits - 1] << 1;
+  for(uint n : range(256)) {
+    uint bits = lengths[n];
+    if(!bits) continue;
+    uint code = next[bits]++, reverse = 0;
+    if(bits > TableBits) continue;
+    for(uint bit : range(bits)) reverse = reverse << 1 | code >> bit & 1;
+    for(uint index = reverse; index < TableSize; index += 1 << bits) single[index] = n | bits << 8;
+  }
+  uint32_t table[TableSize];
+  for(uint index : range(TableSize)) {
+    uint first = single[index], firstLength = first >> 8;
+    if(!firstLength) { table[index] = 0; continue; }
+    uint second = single[index >> firstLength], secondLength = second >> 8;
+    if(secondLength && firstLength + secondLength <= TableBits) {
+      table[index] = (first & 255) | (second & 255) << 8 | 2 << 16 | firstLength << 18 | firstLength + secondLength << 22;
+    } else {
+      table[index] = (first & 255) | 1 << 16 | firstLength << 18 | firstLength << 22;
+    }
+  }
+
+  const uint8_t* data = input.data();
+  uint64_t available = input.size(), position = 0;
+  uint64_t bitbuf = 0;
+  uint bitcnt = 0;
+  auto refill = [&] {
+    #if defined(ENDIAN_LSB)
+    if(position + 8 <= available) {
+      uint64_t word;
+      ::memcpy(&word, data + position, 8);
+      bitbuf |= word << bitcnt;
+      position += 63 - bitcnt >> 3;
+      bitcnt |= 56;
+      return;
+    }
+    #endif
+    //bits past the end of the input read as zero
+    while(bitcnt <= 56) {
+      if(position < available) bitbuf |= (uint64_t)data[position] << bitcnt;
+      position++;
+      bitcnt += 8;
+    }
   };
 
-  uint nodes[256][2] = {};
-  for(uint offset : range(256)) {
-    for(uint index : range(9)) nodes[offset][0] = nodes[offset][0] << 1 | read();
-    for(uint index : range(9)) nodes[offset][1] = nodes[offset][1] << 1 | read();
+  //decodes one code of more than TableBits, or fails on an invalid code
+  auto slow = [&]() -> int {
+    uint code = 0, first = 0, index = 0;
+    for(uint bits = 1; bits < 16; bits++) {
+      code |= bitbuf & 1;
+      bitbuf >>= 1;
+      bitcnt--;
+      if(code - first < counts[bits]) return symbols[index + code - first];
+      index += counts[bits];
+      first = first + counts[bits] << 1;
+      code <<= 1;
+    }
+    return -1;
+  };
+
+  output.resize(size);
+  uint8_t* target = output.data();
+  uint64_t index = 0;
+
+  //a refill leaves at least 56 bits buffered, enough for two lookups of up to 2 * TableBits each;
+  //both symbols of an entry are always stored, while the output has room for them
+  auto decode = [&]() -> bool {
+    uint32_t entry = table[bitbuf & TableSize - 1];
+    if(!(entry >> 16 & 3)) {
+      int symbol = slow();
+      if(symbol < 0) return false;
+      target[index++] = symbol;
+      return true;
+    }
+    target[index + 0] = entry;
+    target[index + 1] = entry >> 8;
+    index += entry >> 16 & 3;
+    bitbuf >>= entry >> 22;
+    bitcnt -= entry >> 22;
+    return true;
+  };
+  while(size - index >= 4) {
+    refill();
+    if(!decode() || !decode()) return {};
   }
 
-  uint node = 511;
-  while(output.size() < size) {
-    node = nodes[node - 256][read()];
-    if(node < 256) {
-      output.append(node);
-      node = 511;
+  while(index < size) {
+    refill();
+    uint32_t entry = table[bitbuf & TableSize - 1];
+    if(entry >> 16 & 3) {
+      target[index++] = entry;
+      bitbuf >>= entry >> 18 & 15;
+      bitcnt -= entry >> 18 & 15;
+    } else {
+      int symbol = slow();
+      if(symbol < 0) return {};
+      target[index++] = symbol;
     }
   }
 
+  //the codes must not have extended past the end of the input
+  if(position * 8 - bitcnt > available * 8) return {};
   return output;
 }
 
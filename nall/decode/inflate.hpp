@@ -1,349 +1,545 @@
 #pragma once
 
-//a bad implementation of inflate from zlib/minizip
-//todo: replace with Talarubi's version
+//DEFLATE decoder (RFC 1951)
+//symbols are resolved through two-level lookup tables fed from a 64-bit bit buffer;
+//output can be decoded either into a buffer of known size, or streamed in chunks,
+//which are either pushed to a writer or pulled one at a time with next()
 
-#include <setjmp.h>
+#include <nall/array-view.hpp>
+#include <nall/function.hpp>
+#include <nall/memory.hpp>
+#include <nall/vector.hpp>
 
 namespace nall::Decode {
 
-namespace puff {
-  inline auto puff(
-    unsigned char* dest, unsigned long* destlen,
-    unsigned char* source, unsigned long* sourcelen
-  ) -> int;
-}
+struct Inflate {
+  //returns the next chunk of compressed input, which must remain valid until the next call;
+  //an empty chunk indicates the end of the input
+  using Reader = function<array_view<uint8_t> ()>;
+  //receives each chunk of decompressed output; returning false aborts decoding
+  using Writer = function<bool (array_view<uint8_t>)>;
+
+  inline auto decode(uint8_t* target, uint64_t targetSize, const uint8_t* source, uint64_t sourceSize) -> bool;
+  inline auto decode(const Reader& reader, const Writer& writer) -> bool;
+  inline auto open(const Reader& reader) -> void;
+  inline auto next() -> array_view<uint8_t>;
+  inline auto finished() const -> bool { return state == Done; }
+  inline auto read(uint8_t* data, uint size) -> bool;
+  inline auto size() const -> uint64_t { return total + pos; }
+
+private:
+  enum : uint { Root = 10, Window = 32768, Slack = 8 };
+  enum : uint { Literal, Base, End, Link, Invalid };
+  enum : uint { Bounds, Block, Error, Suspend };
+  enum : uint { Header, Stored, Codes, Done, Failed };
+
+  //table entries: kind:4, extra:4, value:16, bits:8
+  static auto entry(uint kind, uint value = 0, uint extra = 0) -> uint32_t { return kind << 28 | extra << 24 | value << 8; }
+  inline static auto load(const uint8_t* data) -> uint64_t;
+  inline static auto lengthEntry(uint symbol) -> uint32_t;
+  inline static auto distanceEntry(uint symbol) -> uint32_t;
+
+  inline auto refill() -> bool;
+  inline auto refillSlow() -> bool;
+  inline auto pull() -> bool;
+  auto consume(uint count) -> void { bitbuf >>= count; bitcnt -= count; }
+  auto take(uint count) -> uint { uint data = bitbuf & (1u << count) - 1; consume(count); return data; }
+  inline auto symbol(const uint32_t* table) -> uint32_t;
+
+  template<typename Entry> inline auto build(uint32_t* table, uint tableSize, const uint8_t* lengths, uint count, const Entry&) -> bool;
+  inline auto run() -> void;
+  inline auto stored() -> uint;
+  inline auto fixed() -> bool;
+  inline auto dynamic() -> bool;
+  inline auto codes() -> uint;
+  inline auto fast() -> uint;
+  inline auto copy(uint distance, uint length) -> void;
+  inline auto start() -> void;
+
+  uint state = Header;
+  bool last = false;     //the current block is the final block
+  uint remaining = 0;    //bytes left to copy from the current stored block
+  bool streaming = false;
+
+  vector<uint32_t> lengthTable;
+  vector<uint32_t> distanceTable;
+
+  //input
+  Reader reader;
+  const uint8_t* in = nullptr;
+  const uint8_t* inEnd = nullptr;
+  uint64_t bitbuf = 0;
+  uint bitcnt = 0;
+  uint padding = 0;  //zero bytes appended to the bit buffer past the end of the input
+
+  //output
+  vector<uint8_t> buffer;  //streaming: the last Window bytes of history followed by new output
+  uint8_t* out = nullptr;
+  uint64_t pos = 0;
+  uint64_t end = 0;
+  uint64_t total = 0;  //streaming: bytes discarded from the front of buffer
+};
 
 inline auto inflate(
   uint8_t* target, uint targetLength,
   const uint8_t* source, uint sourceLength
 ) -> bool {
-  unsigned long tl = targetLength, sl = sourceLength;
-  int result = puff::puff((unsigned char*)target, &tl, (unsigned char*)source, &sl);
-  return result == 0;
+  Inflate inflate;
+  return inflate.decode(target, targetLength, source, sourceLength);
 }
 
-namespace puff {
-
-enum : uint {
-  MAXBITS   =  15,
-  MAXLCODES = 286,
-  MAXDCODES =  30,
-  FIXLCODES = 288,
-  MAXCODES  = MAXLCODES + MAXDCODES,
-};
-
-struct state {
-  unsigned char* out;
-  unsigned long outlen;
-  unsigned long outcnt;
-
-  unsigned char* in;
-  unsigned long inlen;
-  unsigned long incnt;
-  int bitbuf;
-  int bitcnt;
-
-  jmp_buf env;
-};
-
-struct huffman {
-  short* count;
-  short* symbol;
-};
-
-inline auto bits(state* s, int need) -> int {
-  long val;
+//decodes into target; fails if the output would exceed targetSize
+auto Inflate::decode(uint8_t* target, uint64_t targetSize, const uint8_t* source, uint64_t sourceSize) -> bool {
+  start();
+  reader.reset();
+  in = source;
+  inEnd = source + sourceSize;
+  streaming = false;
+  out = target;
+  end = targetSize;
+  run();
+  return state == Done;
+}
 
-  val = s->bitbuf;
-  while(s->bitcnt < need) {
-    if(s->incnt == s->inlen) longjmp(s->env, 1);
-    val |= (long)(s->in[s->incnt++]) << s->bitcnt;
-    s->bitcnt += 8;
+auto Inflate::decode(const Reader& reader, const Writer& writer) -> bool {
+  open(reader);
+  while(true) {
+    auto chunk = next();
+    if(!chunk.size()) break;
+    if(!writer(chunk)) return false;
   }
+  return finished();
+}
 
-  s->bitbuf = (int)(val >> need);
-  s->bitcnt -= need;
+//begins decoding a stream; the output is then retrieved with next()
+auto Inflate::open(const Reader& reader) -> void {
+  start();
+  this->reader = reader;
+  in = inEnd = nullptr;
+  streaming = true;
+  buffer.resize(Window * 4);
+  out = buffer.data();
+  end = buffer.size();
+}
 
-  return (int)(val & ((1L << need) - 1));
+//decodes the next chunk of output, which remains valid until the following call;
+//returns an empty chunk once the stream has ended (see finished()) or on error
+auto Inflate::next() -> array_view<uint8_t> {
+  if(pos > Window) {
+    memory::move(out, out + pos - Window, Window);
+    total += pos - Window;
+    pos = Window;
+  }
+  uint64_t from = pos;
+  if(state != Done && state != Failed) run();
+  return {out + from, pos - from};
 }
 
-inline auto stored(state* s) -> int {
-  uint len;
-
-  s->bitbuf = 0;
-  s->bitcnt = 0;
-
-  if(s->incnt + 4 > s->inlen) return 2;
-  len  = s->in[s->incnt++];
-  len |= s->in[s->incnt++] << 8;
-  if(s->in[s->incnt++] != (~len & 0xff) ||
-     s->in[s->incnt++] != ((~len >> 8) & 0xff)
-  ) return 2;
-
-  if(s->incnt + len > s->inlen) return 2;
-  if(s->out != nullptr) {
-    if(s->outcnt + len > s->outlen) return 1;
-    while(len--) s->out[s->outcnt++] = s->in[s->incnt++];
-  } else {
-    s->outcnt += len;
-    s->incnt += len;
+//reads bytes that follow the end of the compressed stream, such as a container trailer
+auto Inflate::read(uint8_t* data, uint size) -> bool {
+  consume(bitcnt & 7);
+  for(uint n : range(size)) {
+    if(bitcnt < 8 && !refill()) return false;
+    if(bitcnt < padding * 8 + 8) return false;
+    data[n] = take(8);
   }
+  return true;
+}
 
-  return 0;
+auto Inflate::start() -> void {
+  if(!lengthTable) lengthTable.resize((1 << Root) + 288 * 32);
+  if(!distanceTable) distanceTable.resize((1 << Root) + 32 * 32);
+  state = Header;
+  last = false;
+  remaining = 0;
+  bitbuf = 0;
+  bitcnt = 0;
+  padding = 0;
+  pos = 0;
+  total = 0;
 }
 
-inline auto decode(state* s, huffman* h) -> int {
-  int len, code, first, count, index, bitbuf, left;
-  short* next;
+//ensures at least 57 bits are buffered; all of the bits needed to decode a length/distance pair
+auto Inflate::refill() -> bool {
+  if(inEnd - in >= 8) {
+    bitbuf |= load(in) << bitcnt;
+    in += 63 - bitcnt >> 3;
+    bitcnt |= 56;
+    return true;
+  }
+  return refillSlow();
+}
 
-  bitbuf = s->bitbuf;
-  left = s->bitcnt;
-  code = first = index = 0;
-  len = 1;
-  next = h->count + 1;
-  while(true) {
-    while(left--) {
-      code |= bitbuf & 1;
-      bitbuf >>= 1;
-      count = *next++;
-      if(code - count < first) {
-        s->bitbuf = bitbuf;
-        s->bitcnt = (s->bitcnt - len) & 7;
-        return h->symbol[index + (code - first)];
-      }
-      index += count;
-      first += count;
-      first <<= 1;
-      code <<= 1;
-      len++;
+auto Inflate::refillSlow() -> bool {
+  if(bitcnt < padding * 8) return false;  //read past the end of the input
+  while(bitcnt <= 56) {
+    if(in == inEnd && !pull()) {
+      padding++;
+      bitcnt += 8;
+      continue;
     }
-    left = (MAXBITS + 1) - len;
-    if(left == 0) break;
-    if(s->incnt == s->inlen) longjmp(s->env, 1);
-    bitbuf = s->in[s->incnt++];
-    if(left > 8) left = 8;
+    bitbuf |= (uint64_t)*in++ << bitcnt;
+    bitcnt += 8;
   }
+  return true;
+}
 
-  return -10;
+auto Inflate::pull() -> bool {
+  if(!reader) return false;
+  auto chunk = reader();
+  in = chunk.data();
+  inEnd = in + chunk.size();
+  return in != inEnd;
 }
 
-inline auto construct(huffman* h, short* length, int n) -> int {
-  int symbol, len, left;
-  short offs[MAXBITS + 1];
+auto Inflate::symbol(const uint32_t* table) -> uint32_t {
+  uint32_t entry = table[bitbuf & (1 << Root) - 1];
+  if(entry >> 28 == Link) {
+    consume(Root);
+    entry = table[(entry >> 8 & 0xffff) + (bitbuf & (1 << (entry >> 24 & 15)) - 1)];
+  }
+  consume(entry & 0xff);
+  return entry;
+}
 
-  for(len = 0; len <= MAXBITS; len++) h->count[len] = 0;
-  for(symbol = 0; symbol < n; symbol++) h->count[length[symbol]]++;
-  if(h->count[0] == n) return 0;
+//builds the lookup table for a canonical Huffman code:
+//codes of up to Root bits resolve with a single lookup, longer codes through a second-level table
+template<typename Entry>
+auto Inflate::build(uint32_t* table, uint tableSize, const uint8_t* lengths, uint count, const Entry& symbolEntry) -> bool {
+  uint counts[16] = {};
+  for(uint n : range(count)) counts[lengths[n]]++;
+  counts[0] = 0;
 
-  left = 1;
-  for(len = 1; len <= MAXBITS; len++) {
+  int left = 1;
+  for(uint bits : range(1, 16)) {
     left <<= 1;
-    left -= h->count[len];
-    if(left < 0) return left;
+    left -= counts[bits];
+    if(left < 0) return false;  //over-subscribed
+  }
+
+  uint next[16] = {};
+  for(uint bits : range(1, 16)) next[bits] = next[bits - 1] + counts[bits - 1] << 1;
+
+  //codes are stored most significant bit first, but are read from the least significant bit
+  uint16_t reversed[320];
+  uint8_t subtables[1 << Root] = {};
+  for(uint n : range(count)) {
+    uint bits = lengths[n];
+    if(!bits) continue;
+    uint code = next[bits]++, reverse = 0;
+    for(uint bit : range(bits)) reverse = reverse << 1 | code >> bit & 1;
+    reversed[n] = reverse;
+    if(bits > Root) {
+      auto& size = subtables[reverse & (1 << Root) - 1];
+      size = max<uint>(size, bits - Root);
+    }
   }
 
-  offs[1] = 0;
-  for(len = 1; len < MAXBITS; len++) offs[len + 1] = offs[len] + h->count[len];
+  for(uint n : range(1 << Root)) table[n] = entry(Invalid);
+  uint offset = 1 << Root;
+  for(uint prefix : range(1 << Root)) {
+    if(!subtables[prefix]) continue;
+    uint size = 1 << subtables[prefix];
+    if(offset + size > tableSize) return false;
+    table[prefix] = entry(Link, offset, subtables[prefix]) | Root;
+    for(uint n : range(size)) table[offset + n] = entry(Invalid);
+    offset += size;
+  }
 
-  for(symbol = 0; symbol < n; symbol++) {
-    if(length[symbol] != 0) h->symbol[offs[length[symbol]]++] = symbol;
+  for(uint n : range(count)) {
+    uint bits = lengths[n];
+    if(!bits) continue;
+    uint reverse = reversed[n];
+    if(bits <= Root) {
+      for(uint index = reverse; index < 1 << Root; index += 1 << bits) table[index] = symbolEntry(n) | bits;
+    } else {
+      uint32_t link = table[reverse & (1 << Root) - 1];
+      uint base = link >> 8 & 0xffff, size = 1 << (link >> 24 & 15);
+      for(uint index = reverse >> Root; index < size; index += 1 << bits - Root) table[base + index] = symbolEntry(n) | bits - Root;
+    }
   }
+  return true;
+}
 
-  return left;
+//unaligned little-endian 64-bit read
+auto Inflate::load(const uint8_t* data) -> uint64_t {
+  #if defined(ENDIAN_LSB)
+  uint64_t value;
+  ::memcpy(&value, data, 8);
+  return value;
+  #else
+  return memory::readl<8>(data);
+  #endif
 }
 
-inline auto codes(state* s, huffman* lencode, huffman* distcode) -> int {
-  int symbol, len;
-  uint dist;
-  static const short lens[29] = {
+auto Inflate::lengthEntry(uint symbol) -> uint32_t {
+  static const uint16_t base[29] = {
     3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
-    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
   };
-  static const short lext[29] = {
+  static const uint8_t extra[29] = {
     0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
-    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
   };
-  static const short dists[30] = {
+  if(symbol < 256) return entry(Literal, symbol);
+  if(symbol == 256) return entry(End);
+  if(symbol < 286) return entry(Base, base[symbol - 257], extra[symbol - 257]);
+  return entry(Invalid);
+}
+
+auto Inflate::distanceEntry(uint symbol) -> uint32_t {
+  static const uint16_t base[30] = {
     1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
-    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
-    8193, 12289, 16385, 24577
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
   };
-  static const short dext[30] = {
+  static const uint8_t extra[30] = {
     0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
-    7, 7, 8, 8, 9, 9, 10, 10, 11, 11,
-    12, 12, 13, 13
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
   };
+  if(symbol < 30) return entry(Base, base[symbol], extra[symbol]);
+  return entry(Invalid);
+}
 
-  do {
-    symbol = decode(s, lencode);
-    if(symbol < 0) return symbol;
-    if(symbol < 256) {
-      if(s->out != nullptr) {
-        if(s->outcnt == s->outlen) return 1;
-        s->out[s->outcnt] = symbol;
-      }
-      s->outcnt++;
-    } else if(symbol > 256) {
-      symbol -= 257;
-      if(symbol >= 29) return -10;
-      len = lens[symbol] + bits(s, lext[symbol]);
-
-      symbol = decode(s, distcode);
-      if(symbol < 0) return symbol;
-      dist = dists[symbol] + bits(s, dext[symbol]);
-      #ifndef INFLATE_ALLOW_INVALID_DISTANCE_TOO_FAR
-      if(dist > s->outcnt) return -11;
-      #endif
-
-      if(s->out != nullptr) {
-        if(s->outcnt + len > s->outlen) return 1;
-        while(len--) {
-          s->out[s->outcnt] =
-          #ifdef INFLATE_ALLOW_INVALID_DISTANCE_TOO_FAR
-          dist > s->outcnt ? 0 :
-          #endif
-          s->out[s->outcnt - dist];
-          s->outcnt++;
-        }
+//decodes blocks until the stream ends, an error occurs, or streamed output must be retrieved
+auto Inflate::run() -> void {
+  while(true) {
+    if(state == Header) {
+      if(!refill()) { state = Failed; return; }
+      last = take(1);
+      uint type = take(2);
+      if(type == 0) {
+        consume(bitcnt & 7);
+        remaining = take(16);
+        if(take(16) != (~remaining & 0xffff)) { state = Failed; return; }
+        state = Stored;
+      } else if(type == 1 && fixed() || type == 2 && dynamic()) {
+        state = Codes;
       } else {
-        s->outcnt += len;
+        state = Failed;
+        return;
       }
     }
-  } while(symbol != 256);
 
-  return 0;
+    uint result = state == Stored ? stored() : codes();
+    if(result == Suspend) return;
+    if(result == Error) { state = Failed; return; }
+    if(!last) { state = Header; continue; }
+    state = bitcnt >= padding * 8 ? Done : Failed;
+    return;
+  }
 }
 
-inline auto fixed(state* s) -> int {
-  static int virgin = 1;
-  static short lencnt[MAXBITS + 1], lensym[FIXLCODES];
-  static short distcnt[MAXBITS + 1], distsym[MAXDCODES];
-  static huffman lencode, distcode;
-
-  if(virgin) {
-    int symbol = 0;
-    short lengths[FIXLCODES];
+auto Inflate::stored() -> uint {
+  //drain the whole bytes held in the bit buffer first, then copy straight from the input
+  while(remaining && bitcnt >= 8) {
+    if(bitcnt < padding * 8 + 8) return Error;
+    if(pos == end) return streaming ? Suspend : Error;
+    out[pos++] = take(8);
+    remaining--;
+  }
+  if(!bitcnt) bitbuf = 0;  //discard look-ahead bits; the input is now read directly
+  while(remaining) {
+    if(in == inEnd && !pull()) return Error;
+    if(pos == end) return streaming ? Suspend : Error;
+    uint size = min<uint64_t>(remaining, inEnd - in, end - pos);
+    ::memcpy(out + pos, in, size);
+    in += size;
+    pos += size;
+    remaining -= size;
+  }
+  return Block;
+}
 
-    lencode.count = lencnt;
-    lencode.symbol = lensym;
-    distcode.count = distcnt;
-    distcode.symbol = distsym;
+auto Inflate::fixed() -> bool {
+  uint8_t lengths[288 + 32];
+  for(uint n : range(144)) lengths[n] = 8;
+  for(uint n : range(144, 256)) lengths[n] = 9;
+  for(uint n : range(256, 280)) lengths[n] = 7;
+  for(uint n : range(280, 288)) lengths[n] = 8;
+  for(uint n : range(288, 320)) lengths[n] = 5;
+  if(!build(lengthTable.data(), lengthTable.size(), lengths, 288, lengthEntry)) return false;
+  return build(distanceTable.data(), distanceTable.size(), lengths + 288, 32, distanceEntry);
+}
 
-    for(; symbol <       144; symbol++) lengths[symbol] = 8;
-    for(; symbol <       256; symbol++) lengths[symbol] = 9;
-    for(; symbol <       280; symbol++) lengths[symbol] = 7;
-    for(; symbol < FIXLCODES; symbol++) lengths[symbol] = 8;
-    construct(&lencode, lengths, FIXLCODES);
+auto Inflate::dynamic() -> bool {
+  static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
 
-    for(symbol = 0; symbol < MAXDCODES; symbol++) lengths[symbol] = 5;
-    construct(&distcode, lengths, MAXDCODES);
+  if(!refill()) return false;
+  uint lengthCount = take(5) + 257;
+  uint distanceCount = take(5) + 1;
+  uint codeCount = take(4) + 4;
+  if(lengthCount > 286 || distanceCount > 30) return false;
 
-    virgin = 0;
+  uint8_t codeLengths[19] = {};
+  for(uint n : range(codeCount)) {
+    if(!refill()) return false;
+    codeLengths[order[n]] = take(3);
   }
+  //the distance table is not yet in use, and holds the code length code meanwhile
+  if(!build(distanceTable.data(), distanceTable.size(), codeLengths, 19, [](uint n) {
+    return entry(n < 19 ? Base : Invalid, n);
+  })) return false;
+
+  uint8_t lengths[288 + 32] = {};
+  uint count = lengthCount + distanceCount;
+  for(uint index = 0; index < count;) {
+    if(!refill()) return false;
+    auto entry = symbol(distanceTable.data());
+    if(entry >> 28 != Base) return false;
+    uint code = entry >> 8 & 0xffff;
+    if(code < 16) {
+      lengths[index++] = code;
+      continue;
+    }
+    uint length = 0, repeat = 0;
+    if(code == 16) {
+      if(index == 0) return false;
+      length = lengths[index - 1];
+      repeat = 3 + take(2);
+    }
+    if(code == 17) repeat = 3 + take(3);
+    if(code == 18) repeat = 11 + take(7);
+    if(index + repeat > count) return false;
+    while(repeat--) lengths[index++] = length;
+  }
+  if(!lengths[256]) return false;  //missing end-of-block code
 
-  return codes(s, &lencode, &distcode);
+  if(!build(lengthTable.data(), lengthTable.size(), lengths, lengthCount, lengthEntry)) return false;
+  return build(distanceTable.data(), distanceTable.size(), lengths + lengthCount, distanceCount, distanceEntry);
 }
 
-inline auto dynamic(state* s) -> int {
-  int nlen, ndist, ncode, index, err;
-  short lengths[MAXCODES];
-  short lencnt[MAXBITS + 1], lensym[MAXLCODES];
-  short distcnt[MAXBITS + 1], distsym[MAXDCODES];
-  huffman lencode, distcode;
-  static const short order[19] = {
-    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
-  };
+auto Inflate::codes() -> uint {
+  const uint32_t* lengths = lengthTable.data();
+  const uint32_t* distances = distanceTable.data();
+  while(true) {
+    if(inEnd - in >= 16 && end - pos >= 258 + Slack) {
+      uint result = fast();
+      if(result != Bounds) return result;
+    }
+    //streaming output is suspended before any symbol that might not fit
+    if(streaming && end - pos < 258) return Suspend;
+    if(!refill()) return Error;
+    auto entry = symbol(lengths);
+    uint kind = entry >> 28;
+    if(kind == Literal) {
+      if(pos == end) return Error;
+      out[pos++] = entry >> 8;
+      continue;
+    }
+    if(kind == End) return Block;
+    if(kind != Base) return Error;
+    uint length = (entry >> 8 & 0xffff) + take(entry >> 24 & 15);
+
+    entry = symbol(distances);
+    if(entry >> 28 != Base) return Error;
+    uint distance = (entry >> 8 & 0xffff) + take(entry >> 24 & 15);
+    if(distance > pos) return Error;
+    if(end - pos < length) return Error;
+    copy(distance, length);
+  }
+}
 
-  lencode.count = lencnt;
-  lencode.symbol = lensym;
-  distcode.count = distcnt;
-  distcode.symbol = distsym;
+//decodes while the input and output are far enough from their ends that no per-symbol bounds checks are needed;
+//the state is held in locals, as stores through out may otherwise alias every member
+auto Inflate::fast() -> uint {
+  const uint32_t* lengths = lengthTable.data();
+  const uint32_t* distances = distanceTable.data();
+  const uint8_t* in = this->in;
+  const uint8_t* inLimit = inEnd - 8;
+  uint8_t* base = out;
+  uint8_t* target = out + pos;
+  uint8_t* outLimit = out + end - 258 - Slack;
+  uint64_t bitbuf = this->bitbuf;
+  uint bitcnt = this->bitcnt;
+  uint result = Bounds;
+
+  auto lookup = [&](const uint32_t* table) -> uint32_t {
+    uint32_t entry = table[bitbuf & (1 << Root) - 1];
+    if(entry >> 28 == Link) {
+      bitbuf >>= Root, bitcnt -= Root;
+      entry = table[(entry >> 8 & 0xffff) + (bitbuf & (1 << (entry >> 24 & 15)) - 1)];
+    }
+    bitbuf >>= entry & 0xff, bitcnt -= entry & 0xff;
+    return entry;
+  };
 
-  nlen = bits(s, 5) + 257;
-  ndist = bits(s, 5) + 1;
-  ncode = bits(s, 4) + 4;
-  if(nlen > MAXLCODES || ndist > MAXDCODES) return -3;
+  auto extra = [&](uint32_t entry) -> uint {
+    uint count = entry >> 24 & 15;
+    uint data = (entry >> 8 & 0xffff) + (bitbuf & (1u << count) - 1);
+    bitbuf >>= count, bitcnt -= count;
+    return data;
+  };
 
-  for(index = 0; index < ncode; index++) lengths[order[index]] = bits(s, 3);
-  for(; index < 19; index++) lengths[order[index]] = 0;
+  while(in <= inLimit && target <= outLimit) {
+    bitbuf |= load(in) << bitcnt;
+    in += 63 - bitcnt >> 3;
+    bitcnt |= 56;
 
-  err = construct(&lencode, lengths, 19);
-  if(err != 0) return -4;
+    auto entry = lookup(lengths);
+    if(entry >> 28 == Literal) {
+      *target++ = entry >> 8;
+      continue;
+    }
+    if(entry >> 28 != Base) {
+      result = entry >> 28 == End ? Block : Error;
+      break;
+    }
+    uint length = extra(entry);
 
-  index = 0;
-  while(index < nlen + ndist) {
-    int symbol, len;
+    entry = lookup(distances);
+    if(entry >> 28 != Base) {
+      result = Error;
+      break;
+    }
+    uint distance = extra(entry);
+    if(distance > target - base) {
+      result = Error;
+      break;
+    }
 
-    symbol = decode(s, &lencode);
-    if(symbol < 16) {
-      lengths[index++] = symbol;
+    const uint8_t* source = target - distance;
+    if(distance >= 8) {
+      //the output limit leaves room for the final word to overrun the match
+      for(uint n = 0; n < length; n += 8) ::memcpy(target + n, source + n, 8);
+      target += length;
+    } else if(distance == 1) {
+      memory::fill<uint8_t>(target, length, *source);
+      target += length;
     } else {
-      len = 0;
-      if(symbol == 16) {
-        if(index == 0) return -5;
-        len = lengths[index - 1];
-        symbol = 3 + bits(s, 2);
-      } else if(symbol == 17) {
-        symbol = 3 + bits(s, 3);
-      } else {
-        symbol = 11 + bits(s, 7);
-      }
-      if(index + symbol > nlen + ndist) return -6;
-      while(symbol--) lengths[index++] = len;
+      while(length--) *target++ = *source++;
     }
   }
 
-  if(lengths[256] == 0) return -9;
-
-  err = construct(&lencode, lengths, nlen);
-  if(err < 0 || (err > 0 && nlen - lencode.count[0] != 1)) return -7;
-
-  err = construct(&distcode, lengths + nlen, ndist);
-  if(err < 0 || (err > 0 && ndist - distcode.count[0] != 1)) return -8;
-
-  return codes(s, &lencode, &distcode);
+  this->in = in;
+  this->bitbuf = bitbuf;
+  this->bitcnt = bitcnt;
+  pos = target - base;
+  return result;
 }
 
-inline auto puff(
-  unsigned char* dest, unsigned long* destlen,
-  unsigned char* source, unsigned long* sourcelen
-) -> int {
-  state s;
-  int last, type, err;
-
-  s.out = dest;
-  s.outlen = *destlen;
-  s.outcnt = 0;
-
-  s.in = source;
-  s.inlen = *sourcelen;
-  s.incnt = 0;
-  s.bitbuf = 0;
-  s.bitcnt = 0;
-
-  if(setjmp(s.env) != 0) {
-    err = 2;
-  } else {
-    do {
-      last = bits(&s, 1);
-      type = bits(&s, 2);
-      err = type == 0 ? stored(&s)
-          : type == 1 ? fixed(&s)
-          : type == 2 ? dynamic(&s)
-          : -1;
-      if(err != 0) break;
-    } while(!last);
+auto Inflate::copy(uint distance, uint length) -> void {
+  uint8_t* target = out + pos;
+  const uint8_t* source = target - distance;
+  pos += length;
+
+  //whole words can be copied once the source no longer overlaps the word being written;
+  //this may write up to seven bytes past the match, which are overwritten by later output
+  if(distance >= 8 && end - pos >= Slack) {
+    while(true) {
+      ::memcpy(target, source, 8);
+      if(length <= 8) return;
+      source += 8;
+      target += 8;
+      length -= 8;
+    }
   }
 
-  if(err <= 0) {
-    *destlen = s.outcnt;
-    *sourcelen = s.incnt;
+  if(distance == 1) {
+    memory::fill<uint8_t>(target, length, *source);
+    return;
   }
 
-  return err;
-}
-
+  while(length--) *target++ = *source++;
 }
 
 }
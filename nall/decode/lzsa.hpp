@@ -1,24 +1,31 @@
 #pragma once
 
+#include <nall/literals.hpp>
+#include <nall/parallel.hpp>
 #include <nall/decode/huffman.hpp>
 
 namespace nall::Decode {
 
-inline auto LZSA(array_view<uint8_t> input) -> vector<uint8_t> {
-  vector<uint8_t> output;
-  uint index = 0;
+//decodes a single block into target[start, start + size), where size is read from the block
+//target[0, start) must hold the dictionary the block was compressed against, if any
+inline auto LZSABlock(array_view<uint8_t> input, uint8_t* target, uint64_t start, uint64_t capacity) -> bool {
+  uint64_t index = start;
 
-  uint size = 0;
-  for(uint byte : range(8)) size |= *input++ << byte * 8;
-  output.resize(size);
+  if(input.size() < 8) return false;
+  uint64_t size = 0;
+  for(uint byte : range(8)) size |= (uint64_t)*input++ << byte * 8;
+  if(size > capacity) return false;
+  size += start;
+  auto output = target;
 
-  auto load = [&]() -> vector<uint8_t> {
-    uint size = 0;
-    for(uint byte : range(8)) size |= *input++ << byte * 8;
-    vector<uint8_t> buffer;
-    buffer.reserve(size);
-    while(size--) buffer.append(*input++);
-    return buffer;
+  auto load = [&]() -> array_view<uint8_t> {
+    uint64_t size = 0;
+    for(uint byte : range(8)) size |= (uint64_t)input(byte) << byte * 8;
+    input += 8;
+    if(size > input.size()) return {};
+    array_view<uint8_t> stream{input.data(), size};
+    input += size;
+    return stream;
   };
 
   auto flags = Decode::Huffman(load());
@@ -26,22 +33,20 @@ inline auto LZSA(array_view<uint8_t> input) -> vector<uint8_t> {
   auto lengths = Decode::Huffman(load());
   auto offsets = Decode::Huffman(load());
 
-  auto flagData = flags.data();
-  uint byte = 0, bits = 0;
-  auto flagRead = [&]() -> bool {
-    if(bits == 0) bits = 8, byte = *flagData++;
-    return byte >> --bits & 1;
-  };
+  //streams are padded, so that tokens can be read (and literals copied in bulk) before bounds are checked
+  for(auto stream : {&literals, &lengths, &offsets}) stream->resize(stream->size() + 16);
+  auto flagEnd = flags.data() + flags.size();
+  auto literalEnd = literals.data() + literals.size() - 16;
+  auto lengthEnd = lengths.data() + lengths.size() - 16;
+  auto offsetEnd = offsets.data() + offsets.size() - 16;
 
+  auto flagData = flags.data();
   auto literalData = literals.data();
-  auto literalRead = [&]() -> uint8_t {
-    return *literalData++;
-  };
 
   auto lengthData = lengths.data();
   auto lengthRead = [&]() -> uint64_t {
     uint byte = *lengthData++, bytes = 1;
-    while(!(byte & 1)) byte >>= 1, bytes++;
+    while(!(byte & 1) && bytes < 5) byte >>= 1, bytes++;
     uint length = byte >> 1, shift = 8 - bytes;
     while(--bytes) length |= *lengthData++ << shift, shift += 8;
     return length;
@@ -56,16 +61,161 @@ inline auto LZSA(array_view<uint8_t> input) -> vector<uint8_t> {
     offset |= *offsetData++ << 24; return offset;
   };
 
+  //flags are consumed most significant bit first, from a left-aligned buffer of flagCount bits
+  uint64_t flagBuffer = 0;
+  uint flagCount = 0;
+  auto flagRefill = [&] {
+    while(flagCount <= 56 && flagData < flagEnd) {
+      flagBuffer |= (uint64_t)*flagData++ << 56 - flagCount;
+      flagCount += 8;
+    }
+  };
+  auto leadingZeros = [](uint64_t value) -> uint {
+    #if defined(COMPILER_GCC) || defined(COMPILER_CLANG)
+    return __builtin_clzll(value);
+    #else
+    uint count = 0;
+    while(!(value >> 63)) value <<= 1, count++;
+    return count;
+    #endif
+  };
+
   while(index < size) {
-    if(!flagRead()) {
-      output[index++] = literalRead();
+    //count the run of literal flags preceding the next match flag, so the literals can be copied at once
+    uint64_t run = 0;
+    bool match = false;
+    while(run < size - index) {
+      flagRefill();
+      if(!flagCount) break;
+      uint zeros = flagBuffer ? leadingZeros(flagBuffer) : 64;
+      if(zeros >= flagCount) {
+        run += flagCount;
+        flagBuffer = 0;
+        flagCount = 0;
+        continue;
+      }
+      run += zeros;
+      flagBuffer = flagBuffer << zeros << 1;
+      flagCount -= zeros + 1;
+      match = true;
+      break;
+    }
+
+    run = min(run, size - index);
+    if(run > literalEnd - literalData) return false;
+    if(run <= 16 && size - index >= 16) {
+      //short runs are copied whole, possibly writing past the run as with matches below
+      ::memcpy(output + index, literalData, 16);
     } else {
-      uint length = lengthRead() + 6;
-      uint offset = index - offsetRead();
-      while(length--) output[index++] = output[offset++];
+      ::memcpy(output + index, literalData, run);
+    }
+    literalData += run;
+    index += run;
+    if(!match) {
+      if(index < size) return false;  //out of flags
+      break;
     }
+
+    uint length = lengthRead() + 6;
+    uint distance = offsetRead();
+    if(lengthData > lengthEnd || offsetData > offsetEnd) return false;
+    if(!distance || distance > index || length > size - index) return false;
+    uint8_t* target = output + index;
+    const uint8_t* source = target - distance;
+    index += length;
+
+    //near the end of the output, copy exactly
+    if(size - index < 8) {
+      for(uint n : range(length)) target[n] = source[n];
+      continue;
+    }
+
+    //otherwise, copy eight bytes at a time, possibly writing up to seven bytes past the match:
+    //those bytes are overwritten by the tokens that follow
+    uint copied = 0;
+    if(distance < 8) {
+      //short periods are first repeated up to a multiple of the period of at least eight bytes,
+      //so that each eight-byte copy reads only bytes that have already been written
+      uint period = (7 / distance + 1) * distance;
+      for(; copied < period && copied < length; copied++) target[copied] = source[copied];
+      source = target - period;
+    }
+    for(; copied < length; copied += 8) ::memcpy(target + copied, source + copied, 8);
   }
 
+  return true;
+}
+
+//decodes either a single block, or a frame of blocks (see Encode::LZSA), in parallel
+inline auto LZSA(array_view<uint8_t> input, uint threads = 0) -> vector<uint8_t> {
+  vector<uint8_t> output;
+
+  //the format does not bound how far a match can expand, so sizes are only trusted up to well beyond
+  //what Encode::LZSA reaches (about 7000:1, on runs of a single byte) before anything is allocated
+  static constexpr uint64_t maximumRatio = 1 << 16;
+
+  uint64_t size = 0;
+  for(uint byte : range(8)) size |= (uint64_t)input(byte) << byte * 8;
+  if(!(size >> 63)) {
+    if(size / maximumRatio > input.size()) return {};
+    output.resize(size);
+    if(!LZSABlock(input, output.data(), 0, size)) output.reset();
+    return output;
+  }
+
+  size &= ~(1ull << 63);
+  auto read = [&]() -> uint64_t {
+    uint64_t value = 0;
+    for(uint byte : range(8)) value |= (uint64_t)input(byte) << byte * 8;
+    input += 8;
+    return value;
+  };
+  input += 8;
+  uint64_t blockSize = read();
+  uint64_t dictionarySize = read();
+  if(!blockSize || blockSize > 1_GiB || dictionarySize > blockSize) return {};
+  if(size / maximumRatio > input.size()) return {};
+
+  //each block is preceded by its 8-byte length: reject headers promising more blocks than the input could hold
+  uint64_t blocks = (size + blockSize - 1) / blockSize;
+  if(!blocks || blocks > input.size() / 8) return {};
+  //every block but the last must decode to exactly blockSize bytes, as its own header must say
+  vector<array_view<uint8_t>> sources;
+  for(uint64_t index : range(blocks)) {
+    if(input.size() < 8) return {};
+    uint64_t length = read();
+    if(length < 8 || length > input.size()) return {};
+    uint64_t stored = 0;
+    for(uint byte : range(8)) stored |= (uint64_t)input(byte) << byte * 8;
+    if(stored != min(blockSize, size - index * blockSize)) return {};
+    sources.append(array_view<uint8_t>{input.data(), length});
+    input += length;
+  }
+
+  output.resize(size);
+  auto decode = [&](uint64_t index, uint8_t* target, uint64_t start) -> bool {
+    uint64_t length = min(blockSize, size - index * blockSize);
+    return LZSABlock(sources[index], target, start, length);
+  };
+
+  //the first block holds the dictionary for the others, and so it is decoded first
+  if(!decode(0, output.data(), 0)) return {};
+  std::atomic<bool> valid{true};
+  parallel(blocks - 1, [&](uint64_t index) {
+    index++;
+    uint64_t offset = index * blockSize;
+    uint64_t length = min(blockSize, size - offset);
+    if(!dictionarySize) {
+      if(!decode(index, output.data() + offset, 0)) valid = false;
+      return;
+    }
+    vector<uint8_t> buffer;
+    buffer.resize(dictionarySize + length);
+    memory::copy(buffer.data(), output.data(), dictionarySize);
+    if(!decode(index, buffer.data(), dictionarySize)) valid = false;
+    memory::copy(output.data() + offset, buffer.data() + dictionarySize, length);
+  }, threads);
+  if(!valid) return {};
   return output;
 }
 
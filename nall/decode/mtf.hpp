@@ -7,15 +7,21 @@ namespace nall::Decode {
 inline auto MTF(array_view<uint8_t> input) -> vector<uint8_t> {
   vector<uint8_t> output;
   output.resize(input.size());
+  auto source = input.data();
+  auto target = output.data();
 
   uint8_t order[256];
   for(uint n : range(256)) order[n] = n;
 
-  for(uint offset : range(input.size())) {
-    uint data = input[offset];
-    uint value = order[data];
-    output[offset] = value;
-    memory::move(&order[1], &order[0], data);
+  for(uint64_t offset : range(input.size())) {
+    uint data = source[offset];
+    uint8_t value = order[data];
+    target[offset] = value;
+    if(data < 16) {
+      for(uint n = data; n; n--) order[n] = order[n - 1];
+    } else {
+      ::memmove(&order[1], &order[0], data);
+    }
     order[0] = value;
   }
 
@@ -1,5 +1,7 @@
 #pragma once
 
+//run-length encoding
+
 namespace nall::Decode {
 
 template<uint S = 1, uint M = 4 / S>  //S = word size; M = match length
@@ -10,31 +12,46 @@ inline auto RLE(array_view<uint8_t> input) -> vector<uint8_t> {
     return input ? *input++ : 0;
   };
 
-  uint base = 0;
+  uint64_t base = 0;
   uint64_t size = 0;
-  for(uint byte : range(8)) size |= load() << byte * 8;
+  for(uint byte : range(8)) size |= (uint64_t)load() << byte * 8;
   output.resize(size);
+  auto target = output.data();
 
   auto read = [&]() -> uint64_t {
     uint64_t value = 0;
-    for(uint byte : range(S)) value |= load() << byte * 8;
+    for(uint byte : range(S)) value |= (uint64_t)load() << byte * 8;
     return value;
   };
 
+  //words extending past the end of the output are truncated
   auto write = [&](uint64_t value) -> void {
-    if(base >= size) return;
-    for(uint byte : range(S)) output[base++] = value >> byte * 8;
+    for(uint byte : range(S)) {
+      if(base >= size) return;
+      target[base++] = value >> byte * 8;
+    }
   };
 
   while(base < size) {
     auto byte = load();
     if(byte < 128) {
-      byte++;
-      while(byte--) write(read());
+      uint words = byte + 1;
+      //literal words are copied directly while they remain within both the input and the output
+      uint64_t length = min<uint64_t>(S * words, min<uint64_t>(input.size(), size - base)) / S * S;
+      ::memcpy(target + base, input.data(), length);
+      input += length;
+      base += length;
+      for(words -= length / S; words; words--) write(read());
     } else {
       auto value = read();
-      byte = (byte & 127) + M;
-      while(byte--) write(value);
+      uint count = (byte & 127) + M;
+      if constexpr(S == 1) {
+        count = min<uint64_t>(count, size - base);
+        memory::fill<uint8_t>(target + base, count, value);
+        base += count;
+      } else {
+        while(count--) write(value);
+      }
     }
   }
 
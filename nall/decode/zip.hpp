@@ -1,18 +1,23 @@
 #pragma once
 
+#include <nall/file-buffer.hpp>
 #include <nall/file-map.hpp>
+#include <nall/shared-pointer.hpp>
 #include <nall/string.hpp>
 #include <nall/vector.hpp>
 #include <nall/decode/inflate.hpp>
+#include <nall/hash/crc32.hpp>
 
 namespace nall::Decode {
 
 struct ZIP {
+  enum : uint { MaximumRatio = 1032 };  //the most that DEFLATE can expand its input by
+
   struct File {
     string name;
     const uint8_t* data;
-    uint size;
-    uint csize;
+    uint64_t size;
+    uint64_t csize;
     uint cmode;  //0 = uncompressed, 8 = deflate
     uint crc32;
     time_t timestamp;
@@ -32,7 +37,7 @@ struct ZIP {
     return true;
   }
 
-  auto open(const uint8_t* data, uint size) -> bool {
+  auto open(const uint8_t* data, uint64_t size) -> bool {
     if(size < 22) return false;
 
     filedata = data;
@@ -42,16 +47,30 @@ struct ZIP {
 
     const uint8_t* footer = data + size - 22;
     while(true) {
-      if(footer <= data + 22) return false;
       if(read(footer, 4) == 0x06054b50) {
         uint commentlength = read(footer + 20, 2);
         if(footer + 22 + commentlength == data + size) break;
       }
+      if(footer == data) return false;
       footer--;
     }
-    const uint8_t* directory = data + read(footer + 16, 4);
+    uint64_t directorySize = read(footer + 12, 4);
+    uint64_t directoryOffset = read(footer + 16, 4);
+
+    //ZIP64: a locator preceding the footer points to a record holding the 64-bit directory size and offset
+    if(footer - data >= 20 && read(footer - 20, 4) == 0x07064b50) {
+      uint64_t offset = read(footer - 20 + 8, 8);
+      if(size < 56 || offset > size - 56) return false;
+      const uint8_t* record = data + offset;
+      if(read(record, 4) != 0x06064b50) return false;
+      directorySize = read(record + 40, 8);
+      directoryOffset = read(record + 48, 8);
+    }
+    if(directoryOffset > size || directorySize > size - directoryOffset) return false;
 
-    while(true) {
+    const uint8_t* directory = data + directoryOffset;
+    const uint8_t* directoryEnd = directory + directorySize;
+    while(directoryEnd - directory >= 46) {
       uint signature = read(directory + 0, 4);
       if(signature != 0x02014b50) break;
 
@@ -76,6 +95,7 @@ struct ZIP {
       uint namelength = read(directory + 28, 2);
       uint extralength = read(directory + 30, 2);
       uint commentlength = read(directory + 32, 2);
+      if(46 + namelength + extralength + commentlength > directoryEnd - directory) return false;
 
       char* filename = new char[namelength + 1];
       memcpy(filename, directory + 46, namelength);
@@ -83,10 +103,33 @@ struct ZIP {
       file.name = filename;
       delete[] filename;
 
-      uint offset = read(directory + 42, 4);
+      uint64_t offset = read(directory + 42, 4);
+
+      //ZIP64: each 32-bit field that is saturated is replaced, in order, from the extended information field
+      const uint8_t* extra = directory + 46 + namelength;
+      const uint8_t* extraEnd = extra + extralength;
+      while(extraEnd - extra >= 4) {
+        uint id = read(extra + 0, 2);
+        uint length = read(extra + 2, 2);
+        if(length > extraEnd - extra - 4) break;
+        if(id == 0x0001) {
+          const uint8_t* field = extra + 4;
+          const uint8_t* fieldEnd = field + length;
+          for(uint64_t* value : {&file.size, &file.csize, &offset}) {
+            if(*value != 0xffffffff || fieldEnd - field < 8) continue;
+            *value = read(field, 8);
+            field += 8;
+          }
+        }
+        extra += 4 + length;
+      }
+
+      if(size < 30 || offset > size - 30 || read(data + offset, 4) != 0x04034b50) return false;
       uint offsetNL = read(data + offset + 26, 2);
       uint offsetEL = read(data + offset + 28, 2);
-      file.data = data + offset + 30 + offsetNL + offsetEL;
+      uint64_t dataOffset = offset + 30 + offsetNL + offsetEL;
+      if(dataOffset > size || file.csize > size - dataOffset) return false;
+      file.data = data + dataOffset;
 
       directory += 46 + namelength + extralength + commentlength;
 
@@ -96,22 +139,84 @@ struct ZIP {
     return true;
   }
 
-  auto extract(File& file) -> vector<uint8_t> {
+  //the size is taken from the archive, so it is only trusted as far as the compressed data could expand to;
+  //entries too large to hold in memory should be decompressed with extractFile() instead
+  auto extract(const File& file) -> vector<uint8_t> {
     vector<uint8_t> buffer;
+    if(file.cmode == 0 && file.size != file.csize) return buffer;
+    if(file.cmode == 8 && file.size / MaximumRatio > file.csize) return buffer;
+    buffer.resize(file.size);
+    if(extract(file, buffer) == false) buffer.reset();
+    return buffer;
+  }
+
+  //decompresses file directly into target, which must hold at least file.size bytes
+  auto extract(const File& file, array_span<uint8_t> target) -> bool {
+    if(target.size() < file.size) return false;
 
     if(file.cmode == 0) {
-      buffer.resize(file.size);
-      memcpy(buffer.data(), file.data, file.size);
+      if(file.csize != file.size) return false;
+      memcpy(target.data(), file.data, file.size);
+    } else if(file.cmode == 8) {
+      Inflate inflate;
+      if(inflate.decode(target.data(), file.size, file.data, file.csize) == false) return false;
+      if(inflate.size() != file.size) return false;
+    } else {
+      return false;
     }
 
+    return Hash::CRC32({target.data(), file.size}).value() == file.crc32;
+  }
+
+  //decompresses file into a new file on disk in chunks, without holding all of it in memory;
+  //the output file is removed if the contents are not intact
+  auto extractFile(const File& file, const string& filename) -> bool {
+    if(file.cmode != 0 && file.cmode != 8) return false;
+    file_buffer fp;
+    if(fp.open(filename, file::mode::write) == false) return false;
+
+    bool intact = false;
+    auto reader = stream(file, intact);
+    while(auto chunk = reader()) fp.write(chunk);
+    fp.close();
+
+    if(intact) return true;
+    file::remove(filename);
+    return false;
+  }
+
+  //returns a reader that yields the contents of file in chunks, decompressing them as they are requested;
+  //it remains valid for as long as the archive is open.
+  //once the reader has returned an empty chunk, intact is set to whether the contents ended where they should,
+  //and matched their size and CRC32: a corrupt or truncated entry otherwise looks like a clean end of file
+  auto stream(const File& file, maybe<bool&> intact = {}) -> Inflate::Reader {
+    array_view<uint8_t> data{file.data, file.csize};
+    bool pending = true;
+    Inflate::Reader reader = [=]() mutable -> array_view<uint8_t> {
+      if(!pending) return {};
+      return pending = false, data;
+    };
+
+    shared_pointer<Inflate> inflate;
     if(file.cmode == 8) {
-      buffer.resize(file.size);
-      if(inflate(buffer.data(), buffer.size(), file.data, file.csize) == false) {
-        buffer.reset();
-      }
+      inflate = new Inflate;
+      inflate->open(reader);
+    } else if(file.cmode != 0) {
+      return [] { return array_view<uint8_t>{}; };
     }
 
-    return buffer;
+    Hash::CRC32 crc32;
+    uint64_t size = 0;
+    return [=]() mutable -> array_view<uint8_t> {
+      auto chunk = inflate ? inflate->next() : reader();
+      if(chunk) {
+        crc32.input(chunk);
+        size += chunk.size();
+      } else if(intact) {
+        intact() = (!inflate || inflate->finished()) && size == file.size && crc32.value() == file.crc32;
+      }
+      return chunk;
+    };
   }
 
   auto close() -> void {
@@ -121,11 +226,11 @@ struct ZIP {
 protected:
   file_map fm;
   const uint8_t* filedata;
-  uint filesize;
+  uint64_t filesize;
 
-  auto read(const uint8_t* data, uint size) -> uint {
-    uint result = 0, shift = 0;
-    while(size--) { result |= *data++ << shift; shift += 8; }
+  auto read(const uint8_t* data, uint size) -> uint64_t {
+    uint64_t result = 0, shift = 0;
+    while(size--) { result |= (uint64_t)*data++ << shift; shift += 8; }
     return result;
   }
 
@@ -1,10 +1,6 @@
 #pragma once
 
-#if defined(EC_REFERENCE)
-  #include <nall/elliptic-curve/modulo25519-reference.hpp>
-#else
-  #include <nall/elliptic-curve/modulo25519-optimized.hpp>
-#endif
+#include <nall/elliptic-curve/edwards25519.hpp>
 
 namespace nall::EllipticCurve {
 
@@ -14,6 +10,15 @@ struct Curve25519 {
     secretKey |= (1_u256 << 254);
     basepoint &= ~0_u256 >> 1;
 
+    //the standard base point corresponds to the Edwards base point, whose multiples are precomputed:
+    //u = (1 + y) / (1 - y)
+    if(basepoint == 9) {
+      static const Edwards25519 edwards;
+      auto p = edwards.baseMultiply(secretKey);
+      field u = (p.z + p.y) * reciprocal(p.z - p.y);
+      return u();
+    }
+
     point p = scalarMultiply(basepoint % P, secretKey);
     field k = p.x * reciprocal(p.z);
     return k();
@@ -41,8 +46,9 @@ private:
 
   inline auto scalarMultiply(field b, uint256_t exponent) const -> point {
     point p{1, 0}, q{b, 1};
+    uint128_t lo = lower(exponent), hi = upper(exponent);
     for(uint bit : reverse(range(255))) {
-      bool condition = exponent >> bit & 1;
+      bool condition = (bit < 128 ? lo >> bit : hi >> bit - 128) & 1;
       cswap(condition, p.x, q.x);
       cswap(condition, p.z, q.z);
       q = montgomeryAdd(p, q, b);
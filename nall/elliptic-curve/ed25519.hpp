@@ -1,28 +1,32 @@
 #pragma once
 
+#include <nall/random.hpp>
 #include <nall/hash/sha512.hpp>
-#if defined(EC_REFERENCE)
-  #include <nall/elliptic-curve/modulo25519-reference.hpp>
-#else
-  #include <nall/elliptic-curve/modulo25519-optimized.hpp>
-#endif
+#include <nall/elliptic-curve/edwards25519.hpp>
 
 namespace nall::EllipticCurve {
 
 static const uint256_t L = (1_u256 << 252) + 27742317777372353535851937790883648493_u256;
 
-struct Ed25519 {
+struct Ed25519 : private Edwards25519 {
+  //one entry of a batch verification
+  struct Signed {
+    array_view<uint8_t> message;
+    uint512_t signature = 0;
+    uint256_t publicKey = 0;
+  };
+
   auto publicKey(uint256_t privateKey) const -> uint256_t {
-    return compress(scalarMultiply(B, clamp(hash(privateKey)) % L));
+    return compress(baseMultiply(clamp(hash(privateKey)) % L));
   }
 
   auto sign(array_view<uint8_t> message, uint256_t privateKey) const -> uint512_t {
     uint512_t H = hash(privateKey);
     uint256_t a = clamp(H) % L;
-    uint256_t A = compress(scalarMultiply(B, a));
+    uint256_t A = compress(baseMultiply(a));
 
     uint512_t r = hash(upper(H), message) % L;
-    uint256_t R = compress(scalarMultiply(B, r));
+    uint256_t R = compress(baseMultiply(r));
 
     uint512_t k = hash(R, A, message) % L;
     uint256_t S = (k * a + r) % L;
@@ -30,27 +34,79 @@ struct Ed25519 {
     return uint512_t(S) << 256 | R;
   }
 
+  //checks [8](S * B - R - k * A) == 0: the check is cofactored, so that it agrees with batch verification
+  //below, and so signatures whose R or A differ from the expected point only by a small-order component
+  //are accepted, whether they are verified alone or within a batch of any size
   auto verify(array_view<uint8_t> message, uint512_t signature, uint256_t publicKey) const -> bool {
     auto R = decompress(lower(signature));
     auto A = decompress(publicKey);
     if(!R || !A) return false;
 
     uint256_t S = upper(signature) % L;
-    uint512_t r = hash(lower(signature), publicKey, message) % L;
-
-    auto p = scalarMultiply(B, S);
-    auto q = edwardsAdd(R(), scalarMultiply(A(), r));
-    if(!onCurve(p) || !onCurve(q)) return false;
-    if(p.x * q.z - q.x * p.z) return false;
-    if(p.y * q.z - q.y * p.z) return false;
-    return true;
+    uint256_t k = hash(lower(signature), publicKey, message) % L;
+
+    auto p = edwardsAdd(baseMultiply(S ? EllipticCurve::L - S : S), edwardsAdd(R(), multiScalarMultiply({&A(), 1}, {&k, 1})));
+    p = edwardsDouble(edwardsDouble(edwardsDouble(p)));
+    return !p.x && !(p.y - p.z);
+  }
+
+  //verifies all signatures at once, by checking a random linear combination of their equations:
+  //[8](sum(z * S) * B - sum(z * R) - sum(z * k * A)) == 0, with z a random 128-bit coefficient per signature.
+  //it accepts exactly the signatures that verify() above accepts (except with probability 2^-128).
+  auto verify(array_view<Signed> batch) const -> bool {
+    if(!batch) return true;
+    if(batch.size() == 1) return verify(batch[0].message, batch[0].signature, batch[0].publicKey);
+
+    CSPRNG::XChaCha20 csprng;
+    vector<point> points;
+    vector<uint256_t> scalars;
+    points.reserve(batch.size() * 2);
+    scalars.reserve(batch.size() * 2);
+    uint256_t s = 0;
+    for(auto& entry : batch) {
+      auto R = decompress(lower(entry.signature));
+      auto A = decompress(entry.publicKey);
+      if(!R || !A) return false;
+
+      uint256_t S = upper(entry.signature) % L;
+      uint256_t k = hash(lower(entry.signature), entry.publicKey, entry.message) % L;
+      uint256_t z = csprng.random<uint128_t>();
+
+      s = (uint512_t(z) * S + s) % L;
+      points.append(R());
+      scalars.append(z);
+      points.append(A());
+      scalars.append((uint512_t(z) * k) % L);
+    }
+
+    auto p = edwardsAdd(baseMultiply(s ? EllipticCurve::L - s : s), multiScalarMultiply(points, scalars));
+    p = edwardsDouble(edwardsDouble(edwardsDouble(p)));
+    return !p.x && !(p.y - p.z);
+  }
+
+  //as above, but records the result of each signature into valid:
+  //failing batches are split in half and retried, so that a few bad signatures do not cost a full pass each.
+  //returns the number of signatures which verified.
+  auto verify(array_view<Signed> batch, array_span<bool> valid) const -> uint64_t {
+    if(valid.size() < batch.size()) return 0;
+    if(batch.size() <= 4) {
+      uint64_t verified = 0;
+      for(uint n : range(batch.size())) {
+        valid[n] = verify(batch[n].message, batch[n].signature, batch[n].publicKey);
+        verified += valid[n];
+      }
+      return verified;
+    }
+    if(verify(batch)) {
+      for(uint n : range(batch.size())) valid[n] = true;
+      return batch.size();
+    }
+    uint half = batch.size() / 2;
+    return verify({batch.data(), half}, {valid.data(), half})
+         + verify({batch.data() + half, batch.size() - half}, {valid.data() + half, batch.size() - half});
   }
 
 private:
-  using field = Modulo25519;
-  struct point { field x, y, z, t; };
-  const field D = -field(121665) * reciprocal(field(121666));
-  const point B = *decompress((field(4) * reciprocal(field(5)))());
   const BarrettReduction<256> L = BarrettReduction<256>{EllipticCurve::L};
 
   inline auto input(Hash::SHA512&) const -> void {}
@@ -68,9 +124,12 @@ private:
   template<typename... P> inline auto hash(P&&... p) const -> uint512_t {
     Hash::SHA512 hash;
     input(hash, forward<P>(p)...);
-    uint512_t result;
-    for(auto byte : reverse(hash.output())) result = result << 8 | byte;
-    return result;
+    //the digest is read as a little-endian integer
+    auto digest = hash.output();
+    array_view<uint8_t> view = digest;
+    uint256_t lo = {view.readl<uint128_t>(16, 16), view.readl<uint128_t>( 0, 16)};
+    uint256_t hi = {view.readl<uint128_t>(48, 16), view.readl<uint128_t>(32, 16)};
+    return {hi, lo};
   }
 
   inline auto clamp(uint256_t p) const -> uint256_t {
@@ -78,67 +137,6 @@ private:
     p |= (1_u256 << 254);
     return p;
   }
-
-  inline auto onCurve(point p) const -> bool {
-    if(!p.z) return false;
-    if(p.x * p.y - p.z * p.t) return false;
-    if(square(p.y) - square(p.x) - square(p.z) - square(p.t) * D) return false;
-    return true;
-  }
-
-  inline auto decompress(uint256_t c) const -> maybe<point> {
-    field y = c & ~0_u256 >> 1;
-    field x = squareRoot((square(y) - 1) * reciprocal(D * square(y) + 1));
-    if(c >> 255) x = -x;
-    point p{x, y, 1, x * y};
-    if(!onCurve(p)) return nothing;
-    return p;
-  }
-
-  inline auto compress(point p) const -> uint256_t {
-    field r = reciprocal(p.z);
-    field x = p.x * r;
-    field y = p.y * r;
-    return (x & 1) << 255 | (y & ~0_u256 >> 1);
-  }
-
-  inline auto edwardsDouble(point p) const -> point {
-    field a = square(p.x);
-    field b = square(p.y);
-    field c = square(p.z);
-    field d = -a;
-    field e = square(p.x + p.y) - a - b;
-    field g = d + b;
-    field f = g - (c + c);
-    field h = d - b;
-    return {e * f, g * h, f * g, e * h};
-  }
-
-  inline auto edwardsAdd(point p, point q) const -> point {
-    field a = (p.y - p.x) * (q.y - q.x);
-    field b = (p.y + p.x) * (q.y + q.x);
-    field c = (p.t + p.t) * q.t * D;
-    field d = (p.z + p.z) * q.z;
-    field e = b - a;
-    field f = d - c;
-    field g = d + c;
-    field h = b + a;
-    return {e * f, g * h, f * g, e * h};
-  }
-
-  inline auto scalarMultiply(point q, uint256_t exponent) const -> point {
-    point p{0, 1, 1, 0}, c;
-    for(uint bit : reverse(range(253))) {
-      p = edwardsDouble(p);
-      c = edwardsAdd(p, q);
-      bool condition = exponent >> bit & 1;
-      cmove(condition, p.x, c.x);
-      cmove(condition, p.y, c.y);
-      cmove(condition, p.z, c.z);
-      cmove(condition, p.t, c.t);
-    }
-    return p;
-  }
 };
 
 }
@@ -0,0 +1,273 @@
+#pragma once
+
+#if defined(EC_REFERENCE)
+  #include <nall/elliptic-curve/modulo25519-reference.hpp>
+#else
+  #include <nall/elliptic-curve/modulo25519-optimized.hpp>
+#endif
+
+namespace nall::EllipticCurve {
+
+//the twisted Edwards curve -x^2 + y^2 = 1 + d * x^2 * y^2, which is birationally equivalent to Curve25519:
+//group arithmetic shared by Ed25519 signatures and fixed-base Curve25519 key generation
+struct Edwards25519 {
+  using field = Modulo25519;
+  struct point { field x, y, z, t; };
+  struct cached { field yPlusX, yMinusX, z2, t2d; };  //a point prepared to be added repeatedly
+  struct affine { field yPlusX, yMinusX, xy2d; };     //as above, with z = 1
+  const field D = -field(121665) * reciprocal(field(121666));
+  const field D2 = D + D;
+  const point B = *decompress((field(4) * reciprocal(field(5)))());
+
+  inline auto onCurve(point p) const -> bool {
+    if(!p.z) return false;
+    if(p.x * p.y - p.z * p.t) return false;
+    if(square(p.y) - square(p.x) - square(p.z) - square(p.t) * D) return false;
+    return true;
+  }
+
+  //z^(2^252 - 3) = z^((P - 5) / 8), by a fixed addition chain
+  inline auto exponentiateP58(field z) const -> field {
+    auto squares = [](field x, uint count) { while(count--) x = square(x); return x; };
+    field z2 = square(z);
+    field z9 = squares(z2, 2) * z;
+    field z11 = z2 * z9;
+    field z5_0 = square(z11) * z9;            //2^5 - 1
+    field z10_0 = squares(z5_0, 5) * z5_0;    //2^10 - 1
+    field z20_0 = squares(z10_0, 10) * z10_0;
+    field z40_0 = squares(z20_0, 20) * z20_0;
+    field z50_0 = squares(z40_0, 10) * z10_0;
+    field z100_0 = squares(z50_0, 50) * z50_0;
+    field z200_0 = squares(z100_0, 100) * z100_0;
+    field z250_0 = squares(z200_0, 50) * z50_0;
+    return squares(z250_0, 2) * z;
+  }
+
+  //x = sqrt(u / v) = u * v^3 * (u * v^7)^((P - 5) / 8), without a separate reciprocal;
+  //as with squareRoot(), the even root is chosen, and non-squares are rejected by onCurve()
+  inline auto decompress(uint256_t c) const -> maybe<point> {
+    static const field I = exponentiate(field(2), P - 1 >> 2);  //I == sqrt(-1)
+    field y = c & ~0_u256 >> 1;
+    field u = square(y) - 1;
+    field v = D * square(y) + 1;
+    field v3 = square(v) * v;
+    field x = u * v3 * exponentiateP58(u * square(v3) * v);
+    if(v * square(x) - u) x = x * I;
+    if(x & 1) x = -x;
+    if(c >> 255) x = -x;
+    point p{x, y, 1, x * y};
+    if(!onCurve(p)) return nothing;
+    return p;
+  }
+
+  inline auto compress(point p) const -> uint256_t {
+    field r = reciprocal(p.z);
+    field x = p.x * r;
+    field y = p.y * r;
+    return (x & 1) << 255 | (y & ~0_u256 >> 1);
+  }
+
+  inline auto edwardsDouble(point p) const -> point {
+    field a = square(p.x);
+    field b = square(p.y);
+    field c = square(p.z);
+    field d = -a;
+    field e = square(p.x + p.y) - a - b;
+    field g = d + b;
+    field f = g - (c + c);
+    field h = d - b;
+    return {e * f, g * h, f * g, e * h};
+  }
+
+  inline auto edwardsAdd(point p, point q) const -> point {
+    field a = (p.y - p.x) * (q.y - q.x);
+    field b = (p.y + p.x) * (q.y + q.x);
+    field c = (p.t + p.t) * q.t * D;
+    field d = (p.z + p.z) * q.z;
+    field e = b - a;
+    field f = d - c;
+    field g = d + c;
+    field h = b + a;
+    return {e * f, g * h, f * g, e * h};
+  }
+
+  inline auto toCached(point p) const -> cached {
+    return {p.y + p.x, p.y - p.x, p.z + p.z, p.t * D2};
+  }
+
+  inline auto negate(cached p) const -> cached {
+    return {p.yMinusX, p.yPlusX, p.z2, -p.t2d};
+  }
+
+  inline auto edwardsAdd(point p, cached q) const -> point {
+    field a = (p.y - p.x) * q.yMinusX;
+    field b = (p.y + p.x) * q.yPlusX;
+    field c = p.t * q.t2d;
+    field d = p.z * q.z2;
+    field e = b - a;
+    field f = d - c;
+    field g = d + c;
+    field h = b + a;
+    return {e * f, g * h, f * g, e * h};
+  }
+
+  inline auto edwardsAdd(point p, affine q) const -> point {
+    field a = (p.y - p.x) * q.yMinusX;
+    field b = (p.y + p.x) * q.yPlusX;
+    field c = p.t * q.xy2d;
+    field d = p.z + p.z;
+    field e = b - a;
+    field f = d - c;
+    field g = d + c;
+    field h = b + a;
+    return {e * f, g * h, f * g, e * h};
+  }
+
+  //recodes a scalar below 2^255 into signed radix-2^bits digits in (-2^(bits-1), 2^(bits-1)],
+  //least significant first; returns the number of digits written
+  inline auto recode(uint256_t scalar, uint bits, int16_t* digits) const -> uint {
+    uint8_t bytes[34] = {};
+    uint128_t lo = lower(scalar), hi = upper(scalar);
+    for(uint n : range(16)) bytes[n] = lo >> n * 8, bytes[16 + n] = hi >> n * 8;
+    uint count = (256 + bits - 1) / bits;
+    int carry = 0;
+    for(uint n : range(count)) {
+      uint bit = n * bits, byte = bit >> 3;
+      int value = (bytes[byte] | bytes[byte + 1] << 8 | bytes[byte + 2] << 16) >> (bit & 7) & (1 << bits) - 1;
+      value += carry;
+      carry = value + (1 << bits - 1) - 1 >> bits;
+      digits[n] = value - (carry << bits);
+    }
+    return count;
+  }
+
+  //rows[n][m] = (m + 1) * 256^n * B
+  struct BaseTable { affine rows[32][8]; };
+
+  inline auto baseTable() const -> const BaseTable& {
+    static const BaseTable table = [&] {
+      vector<point> points;
+      points.resize(256);
+      point base = B;
+      for(uint row : range(32)) {
+        points[row * 8] = base;
+        for(uint n : range(1, 8)) points[row * 8 + n] = edwardsAdd(points[row * 8 + n - 1], base);
+        for(uint n : range(8)) base = edwardsDouble(base);
+      }
+
+      //normalize every point to z = 1 with a single reciprocal
+      vector<field> products;
+      products.resize(256);
+      field product = 1;
+      for(uint n : range(256)) products[n] = product, product = product * points[n].z;
+      field inverse = reciprocal(product);
+
+      BaseTable table;
+      for(uint n : reverse(range(256))) {
+        field r = inverse * products[n];
+        inverse = inverse * points[n].z;
+        field x = points[n].x * r;
+        field y = points[n].y * r;
+        table.rows[n >> 3][n & 7] = {y + x, y - x, x * y * D2};
+      }
+      return table;
+    }();
+    return table;
+  }
+
+  //constant-time: every entry of the row is read, regardless of the digit
+  inline auto select(const affine (&row)[8], int digit) const -> affine {
+    uint negative = (uint)digit >> 31;
+    uint magnitude = (digit ^ -negative) + negative;
+    affine p{1, 1, 0};
+    for(uint n : range(8)) {
+      bool condition = magnitude == n + 1;
+      cmove(condition, p.yPlusX, row[n].yPlusX);
+      cmove(condition, p.yMinusX, row[n].yMinusX);
+      cmove(condition, p.xy2d, row[n].xy2d);
+    }
+    field x = -p.xy2d;
+    cswap(negative, p.yPlusX, p.yMinusX);
+    cmove(negative, p.xy2d, x);
+    return p;
+  }
+
+  //scalar * B, for scalars below 2^255, in constant time:
+  //sum(digit[n] * 16^n * B) is formed from the odd digits, multiplied by 16, and then the even digits are added
+  inline auto baseMultiply(uint256_t scalar) const -> point {
+    int16_t digits[64];
+    recode(scalar, 4, digits);
+    auto& table = baseTable();
+    point p{0, 1, 1, 0};
+    for(uint n = 1; n < 64; n += 2) p = edwardsAdd(p, select(table.rows[n >> 1], digits[n]));
+    p = edwardsDouble(edwardsDouble(edwardsDouble(edwardsDouble(p))));
+    for(uint n = 0; n < 64; n += 2) p = edwardsAdd(p, select(table.rows[n >> 1], digits[n]));
+    return p;
+  }
+
+  //sum(scalars[n] * points[n]), for public scalars below 2^255 only: this is not constant-time.
+  //few points use Straus' method (a table of multiples per point, sharing the doublings);
+  //many points use Pippenger's method (the points of each window are summed into buckets by digit).
+  inline auto multiScalarMultiply(array_view<point> points, array_view<uint256_t> scalars) const -> point {
+    uint count = points.size();
+    point p{0, 1, 1, 0};
+
+    if(count < 128) {
+      vector<cached> tables;
+      vector<int16_t> digits;
+      tables.resize(count * 8);
+      digits.resize(count * 64);
+      for(uint n : range(count)) {
+        recode(scalars[n], 4, &digits[n * 64]);
+        point q = points[n];
+        tables[n * 8] = toCached(q);
+        for(uint m : range(1, 8)) tables[n * 8 + m] = toCached(q = edwardsAdd(q, tables[n * 8]));
+      }
+      for(uint window : reverse(range(64))) {
+        if(window != 63) p = edwardsDouble(edwardsDouble(edwardsDouble(edwardsDouble(p))));
+        for(uint n : range(count)) {
+          int digit = digits[n * 64 + window];
+          if(digit > 0) p = edwardsAdd(p, tables[n * 8 + digit - 1]);
+          if(digit < 0) p = edwardsAdd(p, negate(tables[n * 8 - digit - 1]));
+        }
+      }
+      return p;
+    }
+
+    uint bits = 5;
+    while(bits < 12 && count >> bits + 3) bits++;
+    uint windows = (256 + bits - 1) / bits;
+    uint buckets = 1 << bits - 1;
+
+    vector<cached> terms;
+    vector<int16_t> digits;
+    terms.resize(count);
+    digits.resize(count * windows);
+    for(uint n : range(count)) {
+      terms[n] = toCached(points[n]);
+      recode(scalars[n], bits, &digits[n * windows]);
+    }
+
+    vector<point> bucket;
+    bucket.resize(buckets);
+    for(uint window : reverse(range(windows))) {
+      if(window != windows - 1) for(uint n : range(bits)) p = edwardsDouble(p);
+      for(auto& q : bucket) q = {0, 1, 1, 0};
+      for(uint n : range(count)) {
+        int digit = digits[n * windows + window];
+        if(digit > 0) bucket[digit - 1] = edwardsAdd(bucket[digit - 1], terms[n]);
+        if(digit < 0) bucket[-digit - 1] = edwardsAdd(bucket[-digit - 1], negate(terms[n]));
+      }
+      //sum((m + 1) * bucket[m]), as a running sum of running sums
+      point sum{0, 1, 1, 0}, total{0, 1, 1, 0};
+      for(uint m : reverse(range(buckets))) {
+        sum = edwardsAdd(sum, toCached(bucket[m]));
+        total = edwardsAdd(total, toCached(sum));
+      }
+      p = edwardsAdd(p, toCached(total));
+    }
+    return p;
+  }
+};
+
+}
@@ -199,8 +199,21 @@ inline auto exponentiate(const Modulo25519& lhs, uint256_t exponent) -> Modulo25
   return x;
 }
 
+//lhs^(P - 2) = lhs^(2^255 - 21), by a fixed addition chain of 254 squarings and 11 multiplications
 inline auto reciprocal(const Modulo25519& lhs) -> Modulo25519 {
-  return exponentiate(lhs, P - 2);
+  auto squares = [](Modulo25519 x, uint count) { while(count--) x = square(x); return x; };
+  Modulo25519 z2 = square(lhs);
+  Modulo25519 z9 = squares(z2, 2) * lhs;
+  Modulo25519 z11 = z2 * z9;
+  Modulo25519 z5_0 = square(z11) * z9;  //2^5 - 1
+  Modulo25519 z10_0 = squares(z5_0, 5) * z5_0;
+  Modulo25519 z20_0 = squares(z10_0, 10) * z10_0;
+  Modulo25519 z40_0 = squares(z20_0, 20) * z20_0;
+  Modulo25519 z50_0 = squares(z40_0, 10) * z10_0;
+  Modulo25519 z100_0 = squares(z50_0, 50) * z50_0;
+  Modulo25519 z200_0 = squares(z100_0, 100) * z100_0;
+  Modulo25519 z250_0 = squares(z200_0, 50) * z50_0;
+  return squares(z250_0, 5) * z11;
 }
 
 inline auto squareRoot(const Modulo25519& lhs) -> Modulo25519 {
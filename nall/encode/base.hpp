@@ -25,12 +25,23 @@ template<uint Bits, typename T> inline auto Base(T value) -> string {
   : "";
   static const uint size = ceil(sizeof(T) * 8 / log2(Bits));
 
+  //as many digits as fit in 64 bits are divided out of value at once, and then split natively
+  static const uint64_t power = [] {
+    uint64_t power = Bits;
+    while(power <= ~0ull / Bits) power *= Bits;
+    return power;
+  }();
+
   string result;
   result.resize(size);
   char* data = result.get() + size;
-  for(auto byte : result) {
-    *--data = format[value % Bits];
-    value /= Bits;
+  while(data != result.get()) {
+    uint64_t digits = value % power;
+    value /= power;
+    for(uint64_t scale = 1; scale < power && data != result.get(); scale *= Bits) {
+      *--data = format[digits % Bits];
+      digits /= Bits;
+    }
   }
   return result;
 }
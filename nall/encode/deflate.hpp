@@ -0,0 +1,405 @@
+#pragma once
+
+//DEFLATE encoder (RFC 1951)
+//matches are found with hash chains; each block is then emitted with whichever of
+//dynamic Huffman, fixed Huffman or stored coding is smallest.
+//input is split into 1 MiB segments which are compressed independently, each primed with
+//the preceding 32 KiB as history, so that segments can be compressed in parallel.
+//the output does not depend on the number of threads used.
+
+#include <nall/array-view.hpp>
+#include <nall/parallel.hpp>
+#include <nall/vector.hpp>
+#include <nall/encode/huffman.hpp>
+
+namespace nall::Encode {
+
+struct Deflate {
+  //level: 1 (fastest) through 9 (smallest)
+  //threads: segments compressed at once; 0 = one per processor
+  Deflate(uint level = 6, uint threads = 1) : level(max(1u, min(9u, level))), threads(threads) {}
+
+  inline auto compress(array_view<uint8_t> input) -> vector<uint8_t>;
+
+private:
+  enum : uint { Window = 32768, MinMatch = 3, MaxMatch = 258, Segment = 1 << 20, BlockSymbols = 1 << 15 };
+
+  struct Symbol {
+    uint16_t length;    //literal byte when distance is zero
+    uint16_t distance;
+  };
+
+  struct Writer {
+    auto write(uint data, uint bits) -> void {
+      buffer |= (uint64_t)data << count;
+      count += bits;
+      if(count >= 32) {
+        for(uint n : range(4)) output.append(buffer >> n * 8);
+        buffer >>= 32;
+        count -= 32;
+      }
+    }
+
+    auto align() -> void {
+      if(count & 7) write(0, 8 - (count & 7));
+      while(count) output.append(buffer), buffer >>= 8, count -= 8;
+    }
+
+    vector<uint8_t> output;
+    uint64_t buffer = 0;
+    uint count = 0;
+  };
+
+  struct Tables {
+    Tables() {
+      for(uint code : range(29)) {
+        for(uint length = lengthBase[code]; length < lengthBase[code] + (1 << lengthExtra[code]) && length <= MaxMatch; length++) {
+          lengthCode[length] = code;
+        }
+      }
+      lengthCode[MaxMatch] = 28;
+      for(uint code : range(30)) {
+        for(uint distance = distanceBase[code]; distance < distanceBase[code] + (1 << distanceExtra[code]); distance++) {
+          distanceCode[distance - 1] = code;
+        }
+      }
+    }
+
+    static constexpr uint16_t lengthBase[29] = {
+      3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+    };
+    static constexpr uint8_t lengthExtra[29] = {
+      0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+      3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+    };
+    static constexpr uint16_t distanceBase[30] = {
+      1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+      257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+    };
+    static constexpr uint8_t distanceExtra[30] = {
+      0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+      7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+    };
+
+    uint8_t lengthCode[MaxMatch + 1] = {};
+    uint8_t distanceCode[Window] = {};
+  };
+
+  static auto tables() -> const Tables& {
+    static const Tables tables;
+    return tables;
+  }
+
+  inline auto segment(const uint8_t* data, uint history, uint size, bool final) const -> vector<uint8_t>;
+  inline auto block(Writer& writer, const vector<Symbol>& symbols, const uint8_t* raw, uint rawSize, bool last) const -> void;
+  inline static auto compare(const uint8_t* x, const uint8_t* y, uint limit) -> uint;
+
+  uint level;
+  uint threads;
+};
+
+auto Deflate::compress(array_view<uint8_t> input) -> vector<uint8_t> {
+  uint64_t segments = max<uint64_t>(1, (input.size() + Segment - 1) / Segment);
+  vector<vector<uint8_t>> outputs;
+  outputs.resize(segments);
+  parallel(segments, [&](uint64_t index) {
+    uint64_t offset = index * Segment;
+    uint history = min<uint64_t>(offset, Window);
+    uint size = min<uint64_t>(Segment, input.size() - offset);
+    outputs[index] = segment(input.data() + offset - history, history, history + size, index == segments - 1);
+  }, threads);
+
+  vector<uint8_t> output;
+  uint64_t size = 0;
+  for(auto& segment : outputs) size += segment.size();
+  output.reserve(size);
+  for(auto& segment : outputs) output.append(segment);
+  return output;
+}
+
+//compresses data[history, size), with data[0, history) available to be matched against
+auto Deflate::segment(const uint8_t* data, uint history, uint size, bool final) const -> vector<uint8_t> {
+  //chain: candidates examined per position; nice: length that ends the search early
+  static const struct { uint16_t chain, nice; bool lazy; } settings[10] = {
+    {0, 0, 0}, {4, 8, 0}, {8, 16, 0}, {16, 32, 0}, {16, 32, 1},
+    {32, 64, 1}, {128, 128, 1}, {256, 128, 1}, {1024, 258, 1}, {4096, 258, 1},
+  };
+  auto& setting = settings[level];
+
+  enum : uint { HashBits = 15 };
+  vector<int32_t> head;
+  head.resize(1 << HashBits);
+  for(auto& entry : head) entry = -1;
+  vector<int32_t> previous;
+  previous.resize(Window);
+
+  auto hash = [&](uint position) -> uint {
+    uint32_t value = data[position] | data[position + 1] << 8 | data[position + 2] << 16;
+    return value * 0x9e3779b1u >> 32 - HashBits;
+  };
+
+  auto insert = [&](uint position) {
+    if(position + MinMatch > size) return;
+    uint index = hash(position);
+    previous[position & Window - 1] = head[index];
+    head[index] = position;
+  };
+
+  auto match = [&](uint position, uint& distance) -> uint {
+    uint limit = min<uint>(MaxMatch, size - position);
+    if(limit < MinMatch) return 0;
+    uint best = MinMatch - 1;
+    int candidate = head[hash(position)];
+    for(uint chain = setting.chain; candidate >= 0 && position - candidate <= Window && chain; chain--) {
+      if(data[candidate + best] == data[position + best]) {
+        uint length = compare(data + candidate, data + position, limit);
+        if(length > best) {
+          best = length;
+          distance = position - candidate;
+          if(length >= setting.nice) break;
+        }
+      }
+      candidate = previous[candidate & Window - 1];
+    }
+    //a short match with a long distance costs more than the literals it replaces
+    if(best == MinMatch && distance > 4096) return 0;
+    return best >= MinMatch ? best : 0;
+  };
+
+  for(uint position : range(history)) insert(position);
+
+  Writer writer;
+  vector<Symbol> symbols;
+  symbols.reserve(BlockSymbols);
+  uint blockStart = history;
+  uint covered = history;
+
+  auto flush = [&](bool last) {
+    block(writer, symbols, data + blockStart, covered - blockStart, last);
+    symbols.resize(0);
+    blockStart = covered;
+  };
+
+  auto literal = [&](uint position) {
+    symbols.append({data[position], 0});
+    covered = position + 1;
+    if(symbols.size() == BlockSymbols) flush(false);
+  };
+
+  auto emit = [&](uint position, uint length, uint distance) {
+    symbols.append({(uint16_t)length, (uint16_t)distance});
+    covered = position + length;
+    if(symbols.size() == BlockSymbols) flush(false);
+  };
+
+  uint position = history;
+  if(!setting.lazy) {
+    while(position < size) {
+      uint distance = 0;
+      uint length = match(position, distance);
+      insert(position);
+      if(!length) {
+        literal(position++);
+        continue;
+      }
+      emit(position, length, distance);
+      for(uint next : range(position + 1, position + length)) insert(next);
+      position += length;
+    }
+  } else {
+    //a match is only taken once the match at the following position proves to be no longer
+    bool pending = false;
+    uint pendingLength = 0, pendingDistance = 0;
+    while(position < size) {
+      uint distance = 0;
+      uint length = pendingLength < setting.nice ? match(position, distance) : 0;
+      insert(position);
+      if(pendingLength >= MinMatch && length <= pendingLength) {
+        uint start = position - 1;
+        emit(start, pendingLength, pendingDistance);
+        for(uint next : range(position + 1, start + pendingLength)) insert(next);
+        position = start + pendingLength;
+        pending = false;
+        pendingLength = 0;
+        continue;
+      }
+      if(pending) literal(position - 1);
+      pending = true;
+      pendingLength = length;
+      pendingDistance = distance;
+      position++;
+    }
+    if(pending) literal(position - 1);
+  }
+
+  if(symbols || final) flush(final);
+  if(!final) {
+    //an empty stored block ends the segment on a byte boundary, so segments can be concatenated
+    writer.write(0, 3);
+    writer.align();
+    writer.write(0x0000, 16);
+    writer.write(0xffff, 16);
+  }
+  writer.align();
+  return move(writer.output);
+}
+
+auto Deflate::block(Writer& writer, const vector<Symbol>& symbols, const uint8_t* raw, uint rawSize, bool last) const -> void {
+  static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+  auto& tables = this->tables();
+
+  uint lengthFrequencies[286] = {};
+  uint distanceFrequencies[30] = {};
+  for(auto& symbol : symbols) {
+    if(!symbol.distance) {
+      lengthFrequencies[symbol.length]++;
+    } else {
+      lengthFrequencies[257 + tables.lengthCode[symbol.length]]++;
+      distanceFrequencies[tables.distanceCode[symbol.distance - 1]]++;
+    }
+  }
+  lengthFrequencies[256] = 1;
+
+  //at least two distance codes are always given lengths, as some decoders require
+  uint distanceWeights[30];
+  uint used = 0;
+  for(uint n : range(30)) distanceWeights[n] = distanceFrequencies[n], used += (bool)distanceFrequencies[n];
+  for(uint n = 0; used < 2; n++) if(!distanceWeights[n]) distanceWeights[n] = 1, used++;
+
+  uint8_t lengthLengths[288] = {};  //286 and 287 only take part in the fixed code
+  uint8_t distanceLengths[30];
+  huffmanLengths(lengthFrequencies, 286, 15, lengthLengths);
+  huffmanLengths(distanceWeights, 30, 15, distanceLengths);
+
+  uint lengthCount = 286, distanceCount = 30;
+  while(lengthCount > 257 && !lengthLengths[lengthCount - 1]) lengthCount--;
+  while(distanceCount > 1 && !distanceLengths[distanceCount - 1]) distanceCount--;
+
+  //run-length encode the code lengths with the code length alphabet
+  uint8_t lengths[286 + 30];
+  uint count = lengthCount + distanceCount;
+  for(uint n : range(lengthCount)) lengths[n] = lengthLengths[n];
+  for(uint n : range(distanceCount)) lengths[lengthCount + n] = distanceLengths[n];
+
+  uint8_t runSymbols[286 + 30], runExtras[286 + 30];
+  uint runs = 0;
+  uint codeFrequencies[19] = {};
+  auto run = [&](uint symbol, uint extra = 0) {
+    runSymbols[runs] = symbol;
+    runExtras[runs] = extra;
+    runs++;
+    codeFrequencies[symbol]++;
+  };
+  for(uint index = 0; index < count;) {
+    uint length = lengths[index], repeat = 1;
+    while(index + repeat < count && lengths[index + repeat] == length) repeat++;
+    index += repeat;
+    if(length == 0) {
+      while(repeat >= 11) { uint size = min(repeat, 138u); run(18, size - 11); repeat -= size; }
+      if(repeat >= 3) { run(17, repeat - 3); repeat = 0; }
+    } else {
+      run(length);
+      repeat--;
+      while(repeat >= 3) { uint size = min(repeat, 6u); run(16, size - 3); repeat -= size; }
+    }
+    while(repeat--) run(length);
+  }
+
+  uint8_t codeLengths[19];
+  huffmanLengths(codeFrequencies, 19, 7, codeLengths);
+  uint codeCount = 19;
+  while(codeCount > 4 && !codeLengths[order[codeCount - 1]]) codeCount--;
+
+  //measure each coding in bits
+  uint64_t dynamicBits = 3 + 5 + 5 + 4 + 3 * codeCount;
+  dynamicBits += codeFrequencies[16] * 2 + codeFrequencies[17] * 3 + codeFrequencies[18] * 7;
+  for(uint n : range(19)) dynamicBits += codeFrequencies[n] * codeLengths[n];
+  uint64_t fixedBits = 3;
+  for(uint n : range(286)) {
+    uint extra = n >= 257 ? tables.lengthExtra[n - 257] : 0;
+    dynamicBits += lengthFrequencies[n] * (lengthLengths[n] + extra);
+    fixedBits += lengthFrequencies[n] * ((n < 144 ? 8 : n < 256 ? 9 : n < 280 ? 7 : 8) + extra);
+  }
+  for(uint n : range(30)) {
+    dynamicBits += distanceFrequencies[n] * (distanceLengths[n] + tables.distanceExtra[n]);
+    fixedBits += distanceFrequencies[n] * (5 + tables.distanceExtra[n]);
+  }
+  uint64_t storedBits = max(1u, (rawSize + 65534) / 65535) * (3 + 7 + 32) + rawSize * 8ull;
+
+  if(storedBits < dynamicBits && storedBits < fixedBits) {
+    uint offset = 0;
+    do {
+      uint size = min(rawSize - offset, 65535u);
+      writer.write(last && offset + size == rawSize, 1);
+      writer.write(0, 2);
+      writer.align();
+      writer.write(size, 16);
+      writer.write(~size & 0xffff, 16);
+      for(uint n : range(size)) writer.write(raw[offset + n], 8);
+      offset += size;
+    } while(offset < rawSize);
+    return;
+  }
+
+  if(fixedBits <= dynamicBits) {
+    for(uint n : range(144)) lengthLengths[n] = 8;
+    for(uint n : range(144, 256)) lengthLengths[n] = 9;
+    for(uint n : range(256, 280)) lengthLengths[n] = 7;
+    for(uint n : range(280, 288)) lengthLengths[n] = 8;
+    for(uint n : range(30)) distanceLengths[n] = 5;
+    writer.write(last, 1);
+    writer.write(1, 2);
+  } else {
+    writer.write(last, 1);
+    writer.write(2, 2);
+    writer.write(lengthCount - 257, 5);
+    writer.write(distanceCount - 1, 5);
+    writer.write(codeCount - 4, 4);
+    for(uint n : range(codeCount)) writer.write(codeLengths[order[n]], 3);
+    uint16_t codes[19];
+    huffmanCodes(codeLengths, 19, codes);
+    for(uint n : range(runs)) {
+      uint symbol = runSymbols[n];
+      writer.write(codes[symbol], codeLengths[symbol]);
+      if(symbol == 16) writer.write(runExtras[n], 2);
+      if(symbol == 17) writer.write(runExtras[n], 3);
+      if(symbol == 18) writer.write(runExtras[n], 7);
+    }
+  }
+
+  uint16_t lengthCodes[288], distanceCodes[30];
+  huffmanCodes(lengthLengths, 288, lengthCodes);
+  huffmanCodes(distanceLengths, 30, distanceCodes);
+  for(auto& symbol : symbols) {
+    if(!symbol.distance) {
+      writer.write(lengthCodes[symbol.length], lengthLengths[symbol.length]);
+      continue;
+    }
+    uint code = tables.lengthCode[symbol.length];
+    writer.write(lengthCodes[257 + code], lengthLengths[257 + code]);
+    writer.write(symbol.length - tables.lengthBase[code], tables.lengthExtra[code]);
+    code = tables.distanceCode[symbol.distance - 1];
+    writer.write(distanceCodes[code], distanceLengths[code]);
+    writer.write(symbol.distance - tables.distanceBase[code], tables.distanceExtra[code]);
+  }
+  writer.write(lengthCodes[256], lengthLengths[256]);
+}
+
+//returns the number of leading bytes that match, up to limit
+auto Deflate::compare(const uint8_t* x, const uint8_t* y, uint limit) -> uint {
+  uint length = 0;
+  #if defined(ENDIAN_LSB) && (defined(COMPILER_GCC) || defined(COMPILER_CLANG))
+  while(length + 8 <= limit) {
+    uint64_t a, b;
+    ::memcpy(&a, x + length, 8);
+    ::memcpy(&b, y + length, 8);
+    if(a != b) return length + (__builtin_ctzll(a ^ b) >> 3);
+    length += 8;
+  }
+  #endif
+  while(length < limit && x[length] == y[length]) length++;
+  return length;
+}
+
+}
@@ -1,82 +1,122 @@
 #pragma once
 
+//canonical Huffman coding
+//the output begins with the input size, with bit 63 set to distinguish it from the original
+//tree-based format (which Decode::Huffman still accepts); this is followed by 256 four-bit code
+//lengths, and then the codes themselves, packed least significant bit first
+
+#include <nall/merge-sort.hpp>
+
 namespace nall::Encode {
 
-inline auto Huffman(array_view<uint8_t> input) -> vector<uint8_t> {
-  vector<uint8_t> output;
-  for(uint byte : range(8)) output.append(input.size() >> byte * 8);
+//computes Huffman code lengths of at most limit bits; unused symbols receive a length of zero
+inline auto huffmanLengths(const uint* frequencies, uint count, uint limit, uint8_t* lengths) -> void {
+  vector<uint> symbols;
+  symbols.reserve(count);
+  for(uint n : range(count)) {
+    lengths[n] = 0;
+    if(frequencies[n]) symbols.append(n);
+  }
+  uint used = symbols.size();
+  if(used == 0) return;
+  if(used == 1) return (void)(lengths[symbols[0]] = 1);
 
-  struct Node {
-    uint frequency = 0;
-    uint parent = 0;
-    uint lhs = 0;
-    uint rhs = 0;
+  //leaves sorted by weight, then merged with a second queue of internal nodes built in weight order
+  sort(symbols.data(), used, [&](uint x, uint y) {
+    return frequencies[x] != frequencies[y] ? frequencies[x] < frequencies[y] : x < y;
+  });
+  vector<uint64_t> weights;
+  vector<uint> parents;
+  weights.resize(used * 2);
+  parents.resize(used * 2);
+  for(uint n : range(used)) weights[n] = frequencies[symbols[n]];
+  uint leaf = 0, node = used, next = used;
+  auto take = [&]() -> uint {
+    if(leaf < used && (node == next || weights[leaf] <= weights[node])) return leaf++;
+    return node++;
   };
-  array<Node[512]> nodes;
-  for(uint offset : range(input.size())) nodes[input[offset]].frequency++;
-
-  uint count = 0;
-  for(uint offset : range(511)) {
-    if(nodes[offset].frequency) count++;
-    else nodes[offset].parent = 511;
+  while(next < used * 2 - 1) {
+    uint x = take(), y = take();
+    weights[next] = weights[x] + weights[y];
+    parents[x] = parents[y] = next;
+    next++;
   }
 
-  auto minimum = [&] {
-    uint frequency = ~0, minimum = 511;
-    for(uint index : range(511)) {
-      if(!nodes[index].parent && nodes[index].frequency && nodes[index].frequency < frequency) {
-        frequency = nodes[index].frequency;
-        minimum = index;
+  //parents always follow their children, so depths are resolved walking down from the root
+  vector<uint> depths;
+  depths.resize(next);
+  uint counts[64] = {};
+  for(uint n = next - 1; n-- > 0;) depths[n] = depths[parents[n]] + 1;
+  for(uint n : range(used)) counts[min(depths[n], limit)]++;
+
+  //codes that were too long were shortened above, which oversubscribes the code space:
+  //lengthen shorter codes until the Kraft sum is restored
+  uint64_t total = 0;
+  for(uint bits : range(1, limit + 1)) total += (uint64_t)counts[bits] << limit - bits;
+  while(total > 1ull << limit) {
+    counts[limit]--;
+    for(uint bits = limit - 1; bits > 0; bits--) {
+      if(counts[bits]) {
+        counts[bits]--;
+        counts[bits + 1] += 2;
+        break;
       }
     }
-    return minimum;
-  };
-
-  //group the least two frequently used nodes until only one node remains
-  uint index = 256;
-  for(uint remaining = max(2, count); remaining >= 2; remaining--) {
-    uint lhs = minimum();
-    nodes[lhs].parent = index;
-    uint rhs = minimum();
-    nodes[rhs].parent = index;
-    if(remaining == 2) index = nodes[lhs].parent = nodes[rhs].parent = 511;
-    nodes[index].lhs = lhs;
-    nodes[index].rhs = rhs;
-    nodes[index].parent = 0;
-    nodes[index].frequency = nodes[lhs].frequency + nodes[rhs].frequency;
-    index++;
+    total--;
   }
 
-  uint byte = 0, bits = 0;
-  auto write = [&](bool bit) {
-    byte = byte << 1 | bit;
-    if(++bits == 8) output.append(byte), bits = 0;
-  };
+  //the least frequent symbols take the longest codes
+  uint index = 0;
+  for(uint bits = limit; bits > 0; bits--) {
+    for(uint remaining = counts[bits]; remaining; remaining--) lengths[symbols[index++]] = bits;
+  }
+}
 
-  //only the upper half of the table is needed for decompression
-  //the first 256 nodes are always treated as leaf nodes
-  for(uint offset : range(256)) {
-    for(uint index : reverse(range(9))) write(nodes[256 + offset].lhs >> index & 1);
-    for(uint index : reverse(range(9))) write(nodes[256 + offset].rhs >> index & 1);
+//assigns canonical codes of at most 15 bits, bit-reversed to be written least significant bit first
+inline auto huffmanCodes(const uint8_t* lengths, uint count, uint16_t* codes) -> void {
+  uint counts[16] = {}, next[16] = {};
+  for(uint n : range(count)) counts[lengths[n]]++;
+  counts[0] = 0;
+  for(uint bits : range(1, 16)) next[bits] = next[bits - 1] + counts[bits - 1] << 1;
+  for(uint n : range(count)) {
+    uint bits = lengths[n];
+    codes[n] = 0;
+    if(!bits) continue;
+    uint code = next[bits]++, reverse = 0;
+    for(uint bit : range(bits)) reverse = reverse << 1 | code >> bit & 1;
+    codes[n] = reverse;
   }
+}
+
+inline auto Huffman(array_view<uint8_t> input) -> vector<uint8_t> {
+  vector<uint8_t> output;
+  uint64_t header = input.size() | 1ull << 63;
+  for(uint byte : range(8)) output.append(header >> byte * 8);
+
+  uint frequencies[256] = {};
+  for(uint8_t byte : input) frequencies[byte]++;
+  uint8_t lengths[256];
+  uint16_t codes[256];
+  huffmanLengths(frequencies, 256, 15, lengths);
+  huffmanCodes(lengths, 256, codes);
+  for(uint n = 0; n < 256; n += 2) output.append(lengths[n] | lengths[n + 1] << 4);
 
-  for(uint byte : input) {
-    uint node = byte, length = 0;
-    uint256_t sequence = 0;
-    //traversing the array produces the bitstream in reverse order
-    do {
-      uint parent = nodes[node].parent;
-      bool bit = nodes[nodes[node].parent].rhs == node;
-      sequence = sequence << 1 | bit;
-      length++;
-      node = parent;
-    } while(node != 511);
-    //output the generated bits in the correct order
-    for(uint index : range(length)) {
-      write(sequence >> index & 1);
+  uint64_t bits = 0;
+  for(uint n : range(256)) bits += (uint64_t)frequencies[n] * lengths[n];
+  output.reserve(output.size() + (bits + 7) / 8);
+
+  uint64_t buffer = 0;
+  uint count = 0;
+  for(uint8_t byte : input) {
+    buffer |= (uint64_t)codes[byte] << count;
+    count += lengths[byte];
+    if(count >= 32) {
+      for(uint n : range(4)) output.append(buffer >> n * 8);
+      buffer >>= 32;
+      count -= 32;
     }
   }
-  while(bits) write(0);
+  for(; count; count = count > 8 ? count - 8 : 0) output.append(buffer), buffer >>= 8;
 
   return output;
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <nall/literals.hpp>
+#include <nall/parallel.hpp>
 #include <nall/suffix-array.hpp>
 #include <nall/encode/bwt.hpp>
 #include <nall/encode/huffman.hpp>
@@ -8,12 +10,14 @@
 
 namespace nall::Encode {
 
-inline auto LZSA(array_view<uint8_t> input) -> vector<uint8_t> {
+//compresses input[start, size) as a single block
+//input[0, start) serves as a dictionary: it may be matched against, but is not encoded
+inline auto LZSABlock(array_view<uint8_t> input, uint start = 0) -> vector<uint8_t> {
   vector<uint8_t> output;
-  for(uint byte : range(8)) output.append(input.size() >> byte * 8);
+  for(uint byte : range(8)) output.append(input.size() - start >> byte * 8);
 
   auto suffixArray = SuffixArray(input).lpf();
-  uint index = 0;
+  uint index = start;
   vector<uint8_t> flags;
   vector<uint8_t> literals;
   vector<uint8_t> stringLengths;
@@ -83,4 +87,48 @@ inline auto LZSA(array_view<uint8_t> input) -> vector<uint8_t> {
   return output;
 }
 
+//input that fits within one block is encoded as a single block
+//larger input is split into a frame of independent blocks, which are compressed in parallel:
+//this bounds both memory usage (the suffix array is several times the size of its input)
+//and the size of the input to each suffix array
+//every block after the first may use the first dictionarySize bytes of input as a dictionary
+//
+//frame format:
+//  8 bytes: input size | 1 << 63
+//  8 bytes: block size
+//  8 bytes: dictionary size
+//  for each block: 8 bytes compressed size, followed by the block
+inline auto LZSA(array_view<uint8_t> input, uint64_t blockSize = 4_MiB, uint64_t dictionarySize = 0, uint threads = 0) -> vector<uint8_t> {
+  blockSize = max<uint64_t>(1_KiB, min<uint64_t>(blockSize, 1_GiB));
+  dictionarySize = min(dictionarySize, blockSize);
+  if(input.size() <= blockSize) return LZSABlock(input);
+
+  uint64_t blocks = (input.size() + blockSize - 1) / blockSize;
+  vector<vector<uint8_t>> outputs;
+  outputs.resize(blocks);
+  parallel(blocks, [&](uint64_t index) {
+    uint64_t offset = index * blockSize;
+    uint64_t size = min(blockSize, input.size() - offset);
+    if(index == 0 || dictionarySize == 0) {
+      outputs[index] = LZSABlock({input.data() + offset, size});
+      return;
+    }
+    vector<uint8_t> buffer;
+    buffer.resize(dictionarySize + size);
+    memory::copy(buffer.data(), input.data(), dictionarySize);
+    memory::copy(buffer.data() + dictionarySize, input.data() + offset, size);
+    outputs[index] = LZSABlock(buffer, dictionarySize);
+  }, threads);
+
+  vector<uint8_t> output;
+  for(uint64_t value : {input.size() | (uint64_t)1 << 63, blockSize, dictionarySize}) {
+    for(uint byte : range(8)) output.append(value >> byte * 8);
+  }
+  for(auto& block : outputs) {
+    for(uint byte : range(8)) output.append(block.size() >> byte * 8);
+    output.append(block);
+  }
+  return output;
+}
+
 }
@@ -1,27 +1,47 @@
 #pragma once
 
 //move to front
+//symbols are located within the order table sixteen at a time with SSE2 where available;
+//the table is then shifted with a single block move, or a short loop for nearby symbols
+
+#if defined(ARCHITECTURE_AMD64) && (defined(COMPILER_GCC) || defined(COMPILER_CLANG))
+  #define NALL_MTF_SSE2
+  #include <emmintrin.h>
+#endif
 
 namespace nall::Encode {
 
 inline auto MTF(array_view<uint8_t> input) -> vector<uint8_t> {
   vector<uint8_t> output;
   output.resize(input.size());
+  auto source = input.data();
+  auto target = output.data();
 
-  uint8_t order[256];
+  alignas(16) uint8_t order[256];
   for(uint n : range(256)) order[n] = n;
 
-  for(uint offset : range(input.size())) {
-    uint data = input[offset];
-    for(uint index : range(256)) {
-      uint value = order[index];
-      if(value == data) {
-        output[offset] = index;
-        memory::move(&order[1], &order[0], index);
-        order[0] = value;
-        break;
-      }
+  for(uint64_t offset : range(input.size())) {
+    uint8_t data = source[offset];
+    //repeated symbols dominate block-sorted input
+    if(order[0] == data) { target[offset] = 0; continue; }
+    uint index = 0;
+    #if defined(NALL_MTF_SSE2)
+    __m128i needle = _mm_set1_epi8(data);
+    while(true) {
+      uint mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(order + index)), needle));
+      if(mask) { index += __builtin_ctz(mask); break; }
+      index += 16;
+    }
+    #else
+    while(order[index] != data) index++;
+    #endif
+    target[offset] = index;
+    if(index < 16) {
+      for(uint n = index; n; n--) order[n] = order[n - 1];
+    } else {
+      ::memmove(&order[1], &order[0], index);
     }
+    order[0] = data;
   }
 
   return output;
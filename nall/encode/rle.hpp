@@ -1,5 +1,8 @@
 #pragma once
 
+//run-length encoding
+//runs are measured eight bytes at a time, by comparing against the word repeated across 64 bits
+
 namespace nall::Encode {
 
 template<uint S = 1, uint M = 4 / S>  //S = word size; M = match length
@@ -7,16 +10,19 @@ inline auto RLE(array_view<uint8_t> input) -> vector<uint8_t> {
   vector<uint8_t> output;
   for(uint byte : range(8)) output.append(input.size() >> byte * 8);
 
-  uint base = 0;
+  auto data = input.data();
+  uint64_t size = input.size();
+  uint64_t base = 0;
   uint skip = 0;
 
-  auto load = [&](uint offset) -> uint8_t {
-    return input(offset);
-  };
-
-  auto read = [&](uint offset) -> uint64_t {
+  //words extending past the end of the input are zero-padded
+  auto read = [&](uint64_t offset) -> uint64_t {
     uint64_t value = 0;
-    for(uint byte : range(S)) value |= load(offset + byte) << byte * 8;
+    if(offset + S <= size) {
+      for(uint byte : range(S)) value |= (uint64_t)data[offset + byte] << byte * 8;
+    } else {
+      for(uint byte : range(S)) if(offset + byte < size) value |= (uint64_t)data[offset + byte] << byte * 8;
+    }
     return value;
   };
 
@@ -24,21 +30,54 @@ inline auto RLE(array_view<uint8_t> input) -> vector<uint8_t> {
     for(uint byte : range(S)) output.append(value >> byte * 8);
   };
 
+  //literal words are copied directly, other than a zero-padded final word
   auto flush = [&] {
     output.append(skip - 1);
-    do {
-      write(read(base));
-      base += S;
-    } while(--skip);
+    uint64_t length = min<uint64_t>(S * skip, size - base) / S * S;
+    uint64_t offset = output.size();
+    output.resize(offset + length);
+    ::memcpy(output.data() + offset, data + base, length);
+    for(base += length, skip -= length / S; skip; skip--, base += S) write(read(base));
   };
 
-  while(base + S * skip < input.size()) {
-    uint same = 1;
-    for(uint offset = base + S * (skip + 1); offset < input.size(); offset += S) {
-      if(read(offset) != read(base + S * skip)) break;
-      if(++same == 127 + M) break;
+  //returns the number of consecutive words equal to the word at offset (including itself), up to 127 + M
+  auto measure = [&](uint64_t offset) -> uint {
+    static constexpr uint limit = 127 + M;
+    uint64_t word = read(offset);
+    uint count = 1;
+    offset += S;
+    //most words outside of runs differ from the next word: test that before measuring a run
+    if(offset + S <= size && read(offset) != word) return count;
+    #if defined(ENDIAN_LSB)
+    if constexpr(S <= 8 && 8 % S == 0) {
+      uint64_t pattern = word;
+      for(uint bytes = S; bytes < 8; bytes *= 2) pattern |= pattern << bytes * 8;
+      while(count < limit && offset + 8 <= size) {
+        uint64_t chunk;
+        ::memcpy(&chunk, data + offset, 8);
+        if(uint64_t difference = chunk ^ pattern) {
+          uint bytes = 0;
+          #if defined(COMPILER_GCC) || defined(COMPILER_CLANG)
+          bytes = __builtin_ctzll(difference) >> 3;
+          #else
+          while(!(difference & 0xff)) difference >>= 8, bytes++;
+          #endif
+          return min(limit, count + bytes / S);
+        }
+        count += 8 / S;
+        offset += 8;
+      }
+      if(count >= limit) return limit;
     }
+    #endif
+    for(; count < limit && offset < size; offset += S, count++) {
+      if(read(offset) != word) break;
+    }
+    return count;
+  };
 
+  while(base + S * skip < size) {
+    uint same = measure(base + S * skip);
     if(same < M) {
       if(++skip == 128) flush();
     } else {
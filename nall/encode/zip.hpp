@@ -1,43 +1,64 @@
 #pragma once
 
-//creates uncompressed ZIP archives
+//creates ZIP archives
+//files are stored uncompressed by default, or compressed with DEFLATE when a level is given
 
 #include <nall/string.hpp>
+#include <nall/encode/deflate.hpp>
 #include <nall/hash/crc32.hpp>
 
 namespace nall::Encode {
 
 struct ZIP {
-  ZIP(const string& filename) {
+  //level: 0 = store, 1-9 = DEFLATE compression level
+  //threads: files (or segments of a single file) compressed at once; 0 = one per processor
+  ZIP(const string& filename, uint level = 0, uint threads = 1) : level(level), threads(threads) {
     fp.open(filename, file::mode::write);
     timestamp = time(nullptr);
   }
 
   //append path: append("path/");
   //append file: append("path/file", data, size);
+  //when compressing, files are queued so that they can be compressed in parallel: the queue is flushed
+  //once it holds a file per thread or PendingLimit bytes, and by flush() or upon destruction
   auto append(string filename, const uint8_t* data = nullptr, uint size = 0u, time_t timestamp = 0) -> void {
     filename.transform("\\", "/");
     if(!timestamp) timestamp = this->timestamp;
-    uint32_t checksum = Hash::CRC32({data, size}).digest().hex();
-    directory.append({filename, timestamp, checksum, size, (uint32_t)fp.offset()});
-
-    fp.writel(0x04034b50, 4);         //signature
-    fp.writel(0x0014, 2);             //minimum version (2.0)
-    fp.writel(0x0000, 2);             //general purpose bit flags
-    fp.writel(0x0000, 2);             //compression method (0 = uncompressed)
-    fp.writel(makeTime(timestamp), 2);
-    fp.writel(makeDate(timestamp), 2);
-    fp.writel(checksum, 4);
-    fp.writel(size, 4);               //compressed size
-    fp.writel(size, 4);               //uncompressed size
-    fp.writel(filename.length(), 2);  //file name length
-    fp.writel(0x0000, 2);             //extra field length
-    fp.print(filename);               //file name
+    if(!level || !size) {
+      flush();
+      return write({filename, timestamp}, {data, size}, {});
+    }
+    pending_t file{filename, timestamp};
+    file.data.resize(size);
+    memory::copy(file.data.data(), data, size);
+    pending.append(move(file));
+    pendingSize += size;
+    if(pending.size() >= (threads ? threads : processors()) || pendingSize >= PendingLimit) flush();
+  }
 
-    fp.write({data, size});           //file data
+  //compresses and writes all queued files, in the order they were appended
+  auto flush() -> void {
+    if(!pending) return;
+    vector<vector<uint8_t>> compressed;
+    compressed.resize(pending.size());
+    if(pending.size() == 1) {
+      //a single file is split into segments, which are compressed in parallel instead
+      compressed[0] = Deflate(level, threads).compress(pending[0].data);
+    } else {
+      parallel(pending.size(), [&](uint64_t index) {
+        compressed[index] = Deflate(level, 1).compress(pending[index].data);
+      }, threads);
+    }
+    for(uint index : range(pending.size())) {
+      write(pending[index], pending[index].data, compressed[index]);
+    }
+    pending.reset();
+    pendingSize = 0;
   }
 
   ~ZIP() {
+    flush();
+
     //central directory
     uint baseOffset = fp.offset();
     for(auto& entry : directory) {
@@ -45,11 +66,11 @@ struct ZIP {
       fp.writel(0x0014, 2);                   //version made by (2.0)
       fp.writel(0x0014, 2);                   //version needed to extract (2.0)
       fp.writel(0x0000, 2);                   //general purpose bit flags
-      fp.writel(0x0000, 2);                   //compression method (0 = uncompressed)
+      fp.writel(entry.method, 2);             //compression method (0 = uncompressed, 8 = deflate)
       fp.writel(makeTime(entry.timestamp), 2);
       fp.writel(makeDate(entry.timestamp), 2);
       fp.writel(entry.checksum, 4);
-      fp.writel(entry.size, 4);               //compressed size
+      fp.writel(entry.csize, 4);              //compressed size
       fp.writel(entry.size, 4);               //uncompressed size
       fp.writel(entry.filename.length(), 2);  //file name length
       fp.writel(0x0000, 2);                   //extra field length
@@ -76,6 +97,38 @@ struct ZIP {
   }
 
 protected:
+  enum : uint { PendingLimit = 64 << 20 };  //bytes
+
+  struct pending_t {
+    string filename;
+    time_t timestamp;
+    vector<uint8_t> data;
+  };
+
+  //compressed data is only used when it is smaller than the original data
+  auto write(const pending_t& file, array_view<uint8_t> data, array_view<uint8_t> compressed) -> void {
+    bool deflate = compressed && compressed.size() < data.size();
+    uint16_t method = deflate ? 8 : 0;
+    auto payload = deflate ? compressed : data;
+    uint32_t checksum = Hash::CRC32(data).digest().hex();
+    directory.append({file.filename, file.timestamp, checksum, (uint32_t)payload.size(), (uint32_t)data.size(), method, (uint32_t)fp.offset()});
+
+    fp.writel(0x04034b50, 4);              //signature
+    fp.writel(0x0014, 2);                  //minimum version (2.0)
+    fp.writel(0x0000, 2);                  //general purpose bit flags
+    fp.writel(method, 2);                  //compression method (0 = uncompressed, 8 = deflate)
+    fp.writel(makeTime(file.timestamp), 2);
+    fp.writel(makeDate(file.timestamp), 2);
+    fp.writel(checksum, 4);
+    fp.writel(payload.size(), 4);          //compressed size
+    fp.writel(data.size(), 4);             //uncompressed size
+    fp.writel(file.filename.length(), 2);  //file name length
+    fp.writel(0x0000, 2);                  //extra field length
+    fp.print(file.filename);               //file name
+
+    fp.write(payload);                     //file data
+  }
+
   auto makeTime(time_t timestamp) -> uint16_t {
     tm* info = localtime(&timestamp);
     return (info->tm_hour << 11) | (info->tm_min << 5) | (info->tm_sec >> 1);
@@ -88,14 +141,20 @@ protected:
 
   file_buffer fp;
   time_t timestamp;
+  uint level = 0;
+  uint threads = 1;
   struct entry_t {
     string filename;
     time_t timestamp;
     uint32_t checksum;
+    uint32_t csize;
     uint32_t size;
+    uint16_t method;
     uint32_t offset;
   };
   vector<entry_t> directory;
+  vector<pending_t> pending;
+  uint64_t pendingSize = 0;
 };
 
 }
@@ -119,7 +119,20 @@ struct file_buffer {
   }
 
   auto write(array_view<uint8_t> memory) -> void {
-    for(auto& byte : memory) write(byte);
+    if(memory.size() < buffer.size()) {
+      for(auto& byte : memory) write(byte);
+      return;
+    }
+
+    //large writes bypass the buffer
+    if(!fileHandle) return;             //file not open
+    if(fileMode == mode::read) return;  //writes not permitted
+    bufferFlush();
+    bufferOffset = -1;
+    fseek(fileHandle, fileOffset, SEEK_SET);
+    (void)fwrite(memory.data(), 1, memory.size(), fileHandle);
+    fileOffset += memory.size();
+    if(fileOffset > fileSize) fileSize = fileOffset;
   }
 
   template<typename... P> auto print(P&&... p) -> void {
@@ -214,7 +227,7 @@ struct file_buffer {
 
 private:
   array<uint8_t[4096]> buffer;
-  int bufferOffset = -1;
+  int64_t bufferOffset = -1;
   bool bufferDirty = false;
   FILE* fileHandle = nullptr;
   uint64_t fileOffset = 0;
@@ -3,6 +3,13 @@
 //table-driven galois field modulo 2
 //do not use with GF(2^17) or larger
 
+#include <nall/cpu.hpp>
+
+#if defined(ARCHITECTURE_AMD64) && (defined(COMPILER_GCC) || defined(COMPILER_CLANG))
+  #define NALL_GALOIS_SSSE3
+  #include <tmmintrin.h>
+#endif
+
 namespace nall {
 
 template<typename field, uint Elements, uint Polynomial>
@@ -15,7 +22,7 @@ struct GaloisField {
   auto operator^(field y) const -> type { return x ^ y; }
   auto operator+(field y) const -> type { return x ^ y; }
   auto operator-(field y) const -> type { return x ^ y; }
-  auto operator*(field y) const -> type { return x && y ? exp(log(x) + log(y)) : 0; }
+  auto operator*(field y) const -> type { return product(x, y); }
   auto operator/(field y) const -> type { return x && y ? exp(log(x) + Elements - log(y)) : 0; }
 
   auto& operator =(field y) { return x = y, *this; }
@@ -64,7 +71,103 @@ struct GaloisField {
     return exp[x % Elements];
   }
 
+  //multiplies without branching: powers are tabulated across twice the multiplicative group, so that
+  //the sum of two logarithms needs no modulo; and zero is assigned a logarithm of twice the group size,
+  //so that any product with zero indexes a zero-filled region beyond the powers
+  static auto product(uint x, uint y) -> field {
+    enum : uint { Size = bit::round(Elements), Mask = Size - 1, Zero = 2 * Elements };
+    struct Tables {
+      uint32_t log[Size];
+      field exp[4 * Elements + 1];
+    };
+    static const Tables tables = [] {
+      Tables tables{};
+      for(uint n : range(Size)) tables.log[n] = n && n <= Elements ? log(n) : Zero;
+      for(uint n : range(2 * Elements)) tables.exp[n] = exp(n);
+      return tables;
+    }();
+    return tables.exp[tables.log[x & Mask] + tables.log[y & Mask]];
+  }
+
   field x;
 };
 
+//arithmetic over entire regions of GF(2^8) elements, for codes which process many codewords at once:
+//a product c * x is split into c * (x & 0x0f) ^ c * (x & 0xf0), so that each coefficient needs only two
+//sixteen-entry tables, and with SSSE3 these are looked up sixteen bytes at a time by PSHUFB
+template<uint Polynomial>
+struct GaloisRegion {
+  using Field = GaloisField<uint8_t, 255, Polynomial>;
+
+  //the split tables of a coefficient, which may be prepared once and reused across many regions
+  struct Multiplier {
+    Multiplier(uint8_t coefficient = 0) : coefficient(coefficient) {
+      for(uint n : range(16)) {
+        lo[n] = Field::product(coefficient, n);
+        hi[n] = Field::product(coefficient, n << 4);
+      }
+    }
+
+    alignas(16) uint8_t lo[16];
+    alignas(16) uint8_t hi[16];
+    uint8_t coefficient;
+  };
+
+  //target[n] ^= coefficient * source[n]
+  static auto multiplyAccumulate(uint8_t* target, const uint8_t* source, uint64_t size, const Multiplier& multiplier) -> void {
+    if(multiplier.coefficient == 0) return;
+    if(multiplier.coefficient == 1) {
+      for(uint64_t n : range(size)) target[n] ^= source[n];
+      return;
+    }
+    kernel<true>(target, source, size, multiplier);
+  }
+
+  //target[n] = coefficient * source[n]; target may equal source
+  static auto multiply(uint8_t* target, const uint8_t* source, uint64_t size, const Multiplier& multiplier) -> void {
+    if(multiplier.coefficient == 0) {
+      for(uint64_t n : range(size)) target[n] = 0;
+      return;
+    }
+    if(multiplier.coefficient == 1) {
+      if(target != source) ::memmove(target, source, size);
+      return;
+    }
+    kernel<false>(target, source, size, multiplier);
+  }
+
+private:
+  template<bool Accumulate>
+  static auto kernel(uint8_t* target, const uint8_t* source, uint64_t size, const Multiplier& multiplier) -> void {
+    uint64_t offset = 0;
+    #if defined(NALL_GALOIS_SSSE3)
+    if(CPU::features().ssse3) offset = kernelSSSE3<Accumulate>(target, source, size, multiplier.lo, multiplier.hi);
+    #endif
+    for(; offset < size; offset++) {
+      uint8_t value = multiplier.lo[source[offset] & 15] ^ multiplier.hi[source[offset] >> 4];
+      target[offset] = Accumulate ? target[offset] ^ value : value;
+    }
+  }
+
+  #if defined(NALL_GALOIS_SSSE3)
+  template<bool Accumulate>
+  __attribute__((target("ssse3"))) static auto kernelSSSE3(uint8_t* target, const uint8_t* source, uint64_t size, const uint8_t* lo, const uint8_t* hi) -> uint64_t {
+    __m128i tableLo = _mm_load_si128((const __m128i*)lo);
+    __m128i tableHi = _mm_load_si128((const __m128i*)hi);
+    __m128i mask = _mm_set1_epi8(15);
+    uint64_t offset = 0;
+    for(; offset + 16 <= size; offset += 16) {
+      __m128i value = _mm_loadu_si128((const __m128i*)(source + offset));
+      __m128i product = _mm_xor_si128(
+        _mm_shuffle_epi8(tableLo, _mm_and_si128(value, mask)),
+        _mm_shuffle_epi8(tableHi, _mm_and_si128(_mm_srli_epi64(value, 4), mask))
+      );
+      if(Accumulate) product = _mm_xor_si128(product, _mm_loadu_si128((const __m128i*)(target + offset)));
+      _mm_storeu_si128((__m128i*)(target + offset), product);
+    }
+    return offset;
+  }
+  #endif
+};
+
 }
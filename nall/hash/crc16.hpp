@@ -17,7 +17,25 @@ struct CRC16 : Hash {
   }
 
   auto input(uint8_t value) -> void override {
-    checksum = (checksum >> 8) ^ table(checksum ^ value);
+    checksum = (checksum >> 8) ^ tables().table[0][(checksum ^ value) & 0xff];
+  }
+
+  //slicing-by-8: eight bytes are folded into the checksum with eight independent table lookups
+  auto input(const void* data, uint64_t size) -> void override {
+    auto p = (const uint8_t*)data;
+    #if defined(ENDIAN_LSB)
+    auto& table = tables().table;
+    for(; size >= 8; p += 8, size -= 8) {
+      uint64_t word;
+      ::memcpy(&word, p, 8);
+      word ^= checksum;
+      checksum = table[7][word >>  0 & 0xff] ^ table[6][word >>  8 & 0xff]
+               ^ table[5][word >> 16 & 0xff] ^ table[4][word >> 24 & 0xff]
+               ^ table[3][word >> 32 & 0xff] ^ table[2][word >> 40 & 0xff]
+               ^ table[1][word >> 48 & 0xff] ^ table[0][word >> 56 & 0xff];
+    }
+    #endif
+    while(size--) input(*p++);
   }
 
   auto output() const -> vector<uint8_t> override {
@@ -31,22 +49,26 @@ struct CRC16 : Hash {
   }
 
 private:
-  static auto table(uint8_t index) -> uint16_t {
-    static uint16_t table[256] = {0};
-    static bool initialized = false;
-
-    if(!initialized) {
-      initialized = true;
-      for(auto index : range(256)) {
-        uint16_t crc = index;
-        for(auto bit : range(8)) {
-          crc = (crc >> 1) ^ (crc & 1 ? 0x8408 : 0);
-        }
-        table[index] = crc;
+  //generated at compile-time, and so may be shared between threads:
+  //table[0] advances the checksum by one byte; table[n] by one byte followed by n zero bytes
+  struct Tables {
+    constexpr Tables() {
+      for(uint n = 0; n < 256; n++) {
+        uint16_t crc = n;
+        for(uint bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (crc & 1 ? 0x8408 : 0);
+        table[0][n] = crc;
+      }
+      for(uint n = 0; n < 256; n++) {
+        for(uint k = 1; k < 8; k++) table[k][n] = table[k - 1][n] >> 8 ^ table[0][table[k - 1][n] & 0xff];
       }
     }
 
-    return table[index];
+    uint16_t table[8][256] = {};
+  };
+
+  static auto tables() -> const Tables& {
+    static constexpr Tables tables;
+    return tables;
   }
 
   uint16_t checksum = 0;
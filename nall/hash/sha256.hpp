@@ -1,6 +1,12 @@
 #pragma once
 
 #include <nall/hash/hash.hpp>
+#include <nall/cpu.hpp>
+
+#if (defined(ARCHITECTURE_X86) || defined(ARCHITECTURE_AMD64)) && (defined(COMPILER_GCC) || defined(COMPILER_CLANG))
+  #define NALL_SHA256_SHANI
+  #include <immintrin.h>
+#endif
 
 namespace nall::Hash {
 
@@ -14,7 +20,6 @@ struct SHA256 : Hash {
 
   auto reset() -> void override {
     for(auto& n : queue) n = 0;
-    for(auto& n : w) n = 0;
     for(auto  n : range(8)) h[n] = square(n);
     queued = length = 0;
   }
@@ -24,6 +29,19 @@ struct SHA256 : Hash {
     length++;
   }
 
+  //bulk input: whole 64-byte blocks are compressed directly from the source buffer
+  auto input(const void* data, uint64_t size) -> void override {
+    auto p = (const uint8_t*)data;
+    length += size;
+    while(queued && size) byte(*p++), size--;
+    if(auto count = size >> 6) {
+      compress()(h, p, count);
+      p += count << 6;
+      size &= 63;
+    }
+    while(size--) byte(*p++);
+  }
+
   auto output() const -> vector<uint8_t> override {
     SHA256 self(*this);
     self.finish();
@@ -35,38 +53,37 @@ struct SHA256 : Hash {
   }
 
   auto value() const -> uint256_t {
-    uint256_t value = 0;
-    for(auto byte : output()) value = value << 8 | byte;
-    return value;
+    auto output = this->output();
+    uint128_t hi = 0, lo = 0;
+    for(uint n : range(16)) hi = hi << 8 | output[n], lo = lo << 8 | output[16 + n];
+    return {hi, lo};
   }
 
-private:
-  auto byte(uint8_t value) -> void {
-    uint32_t shift = (3 - (queued & 3)) * 8;
-    queue[queued >> 2] &= ~(0xff << shift);
-    queue[queued >> 2] |= (value << shift);
-    if(++queued == 64) block(), queued = 0;
+  //intermediate state: allows resuming a hash over data whose prefix has not changed
+  //only available on 64-byte boundaries, when no input is queued
+  auto state() const -> vector<uint8_t> {
+    vector<uint8_t> result;
+    if(queued) return result;
+    for(auto h : this->h) {
+      for(auto n : reverse(range(4))) result.append(h >> n * 8);
+    }
+    return result;
   }
 
-  auto block() -> void {
-    for(auto n : range(16)) w[n] = queue[n];
-    for(auto n : range(16, 64)) {
-      uint32_t a = ror(w[n - 15],  7) ^ ror(w[n - 15], 18) ^ (w[n - 15] >>  3);
-      uint32_t b = ror(w[n -  2], 17) ^ ror(w[n -  2], 19) ^ (w[n -  2] >> 10);
-      w[n] = w[n - 16] + w[n - 7] + a + b;
-    }
-    uint32_t t[8];
-    for(auto n : range(8)) t[n] = h[n];
-    for(auto n : range(64)) {
-      uint32_t a = ror(t[0], 2) ^ ror(t[0], 13) ^ ror(t[0], 22);
-      uint32_t b = ror(t[4], 6) ^ ror(t[4], 11) ^ ror(t[4], 25);
-      uint32_t c = (t[0] & t[1]) ^ (t[0] & t[2]) ^ (t[1] & t[2]);
-      uint32_t d = (t[4] & t[5]) ^ (~t[4] & t[6]);
-      uint32_t e = t[7] + w[n] + cube(n) + b + d;
-      t[7] = t[6]; t[6] = t[5]; t[5] = t[4]; t[4] = t[3] + e;
-      t[3] = t[2]; t[2] = t[1]; t[1] = t[0]; t[0] = a + c + e;
-    }
-    for(auto n : range(8)) h[n] += t[n];
+  auto resume(array_view<uint8_t> state, uint64_t length) -> bool {
+    if(state.size() != 32 || length & 63) return false;
+    reset();
+    for(auto& h : this->h) h = state.readm<uint32_t>(4);
+    this->length = length;
+    return true;
+  }
+
+private:
+  using Compress = auto (*)(uint32_t*, const uint8_t*, uint64_t) -> void;
+
+  auto byte(uint8_t value) -> void {
+    queue[queued] = value;
+    if(++queued == 64) compress()(h, queue, 1), queued = 0;
   }
 
   auto finish() -> void {
@@ -75,15 +92,100 @@ private:
     for(auto n : range(8)) byte(length * 8 >> (7 - n) * 8);
   }
 
-  auto square(uint n) -> uint32_t {
+  //selects the fastest compression function supported by the host processor
+  static auto compress() -> Compress {
+    #if defined(NALL_SHA256_SHANI)
+    static const Compress function = CPU::features().sha && CPU::features().sse41 ? blocksSHANI : blocks;
+    return function;
+    #else
+    return blocks;
+    #endif
+  }
+
+  static auto blocks(uint32_t* h, const uint8_t* data, uint64_t count) -> void {
+    while(count--) {
+      uint32_t w[64];
+      for(auto n : range(16)) {
+        w[n] = data[n * 4 + 0] << 24 | data[n * 4 + 1] << 16 | data[n * 4 + 2] << 8 | data[n * 4 + 3] << 0;
+      }
+      for(auto n : range(16, 64)) {
+        uint32_t a = ror(w[n - 15],  7) ^ ror(w[n - 15], 18) ^ (w[n - 15] >>  3);
+        uint32_t b = ror(w[n -  2], 17) ^ ror(w[n -  2], 19) ^ (w[n -  2] >> 10);
+        w[n] = w[n - 16] + w[n - 7] + a + b;
+      }
+
+      uint32_t t[8];
+      for(auto n : range(8)) t[n] = h[n];
+      //rotate register names instead of values: eight rounds per iteration
+      auto round = [&](uint32_t a, uint32_t b, uint32_t c, uint32_t& d, uint32_t e, uint32_t f, uint32_t g, uint32_t& h, uint n) {
+        uint32_t x = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + (g ^ (e & (f ^ g))) + cube(n) + w[n];
+        uint32_t y = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) | (c & (a | b)));
+        d += x;
+        h = x + y;
+      };
+      for(uint n = 0; n < 64; n += 8) {
+        round(t[0], t[1], t[2], t[3], t[4], t[5], t[6], t[7], n + 0);
+        round(t[7], t[0], t[1], t[2], t[3], t[4], t[5], t[6], n + 1);
+        round(t[6], t[7], t[0], t[1], t[2], t[3], t[4], t[5], n + 2);
+        round(t[5], t[6], t[7], t[0], t[1], t[2], t[3], t[4], n + 3);
+        round(t[4], t[5], t[6], t[7], t[0], t[1], t[2], t[3], n + 4);
+        round(t[3], t[4], t[5], t[6], t[7], t[0], t[1], t[2], n + 5);
+        round(t[2], t[3], t[4], t[5], t[6], t[7], t[0], t[1], n + 6);
+        round(t[1], t[2], t[3], t[4], t[5], t[6], t[7], t[0], n + 7);
+      }
+      for(auto n : range(8)) h[n] += t[n];
+      data += 64;
+    }
+  }
+
+  #if defined(NALL_SHA256_SHANI)
+  //Intel SHA extensions: four rounds per pair of sha256rnds2 instructions
+  __attribute__((target("sha,sse4.1"))) static auto blocksSHANI(uint32_t* h, const uint8_t* data, uint64_t count) -> void {
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+
+    __m128i t = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[0]), 0xb1);  //CDAB
+    __m128i s1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[4]), 0x1b);  //EFGH
+    __m128i s0 = _mm_alignr_epi8(t, s1, 8);  //ABEF
+    s1 = _mm_blend_epi16(s1, t, 0xf0);  //CDGH
+
+    while(count--) {
+      __m128i abef = s0, cdgh = s1;
+      __m128i m[4];
+      for(uint g = 0; g < 16; g++) {
+        auto& cur  = m[(g + 0) & 3];
+        auto& next = m[(g + 1) & 3];
+        auto& prev = m[(g + 3) & 3];
+        if(g < 4) cur = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + g * 16)), mask);
+        __m128i k = _mm_add_epi32(cur, _mm_loadu_si128((const __m128i*)&cube(g * 4)));
+        s1 = _mm_sha256rnds2_epu32(s1, s0, k);
+        if(g >= 3 && g <= 14) {
+          next = _mm_add_epi32(next, _mm_alignr_epi8(cur, prev, 4));
+          next = _mm_sha256msg2_epu32(next, cur);
+        }
+        s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(k, 0x0e));
+        if(g >= 1 && g <= 12) prev = _mm_sha256msg1_epu32(prev, cur);
+      }
+      s0 = _mm_add_epi32(s0, abef);
+      s1 = _mm_add_epi32(s1, cdgh);
+      data += 64;
+    }
+
+    t = _mm_shuffle_epi32(s0, 0x1b);  //FEBA
+    s1 = _mm_shuffle_epi32(s1, 0xb1);  //DCHG
+    _mm_storeu_si128((__m128i*)&h[0], _mm_blend_epi16(t, s1, 0xf0));  //DCBA
+    _mm_storeu_si128((__m128i*)&h[4], _mm_alignr_epi8(s1, t, 8));  //HGFE
+  }
+  #endif
+
+  static auto square(uint n) -> uint32_t {
     static const uint32_t value[8] = {
       0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
     };
     return value[n];
   }
 
-  auto cube(uint n) -> uint32_t {
-    static const uint32_t value[64] = {
+  static auto cube(uint n) -> const uint32_t& {
+    alignas(16) static const uint32_t value[64] = {
       0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
       0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
       0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
@@ -96,8 +198,7 @@ private:
     return value[n];
   }
 
-  uint32_t queue[16] = {0};
-  uint32_t w[64] = {0};
+  uint8_t queue[64] = {0};
   uint32_t h[8] = {0};
   uint32_t queued = 0;
   uint64_t length = 0;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <nall/literals.hpp>
+#include <nall/parallel.hpp>
 #include <nall/hash/hash.hpp>
 
 namespace nall::Hash {
@@ -14,7 +16,6 @@ struct SHA512 : Hash {
 
   auto reset() -> void override {
     for(auto& n : queue) n = 0;
-    for(auto& n : w) n = 0;
     for(auto  n : range(8)) h[n] = square(n);
     queued = length = 0;
   }
@@ -24,6 +25,19 @@ struct SHA512 : Hash {
     length++;
   }
 
+  //bulk input: whole 128-byte blocks are compressed directly from the source buffer
+  auto input(const void* data, uint64_t size) -> void override {
+    auto p = (const uint8_t*)data;
+    length += size;
+    while(queued && size) byte(*p++), size--;
+    if(auto count = size >> 7) {
+      blocks(h, p, count);
+      p += count << 7;
+      size &= 127;
+    }
+    while(size--) byte(*p++);
+  }
+
   auto output() const -> vector<uint8_t> override {
     SHA512 self(*this);
     self.finish();
@@ -35,38 +49,51 @@ struct SHA512 : Hash {
   }
 
   auto value() const -> uint512_t {
-    uint512_t value = 0;
-    for(auto byte : output()) value = value << 8 | byte;
-    return value;
+    SHA512 self(*this);
+    self.finish();
+    uint256_t hi = {uint128_t(self.h[0]) << 64 | self.h[1], uint128_t(self.h[2]) << 64 | self.h[3]};
+    uint256_t lo = {uint128_t(self.h[4]) << 64 | self.h[5], uint128_t(self.h[6]) << 64 | self.h[7]};
+    return {hi, lo};
   }
 
-private:
-  auto byte(uint8_t data) -> void {
-    uint64_t shift = (7 - (queued & 7)) * 8;
-    queue[queued >> 3] &=~((uint64_t)0xff << shift);
-    queue[queued >> 3] |= ((uint64_t)data << shift);
-    if(++queued == 128) block(), queued = 0;
-  }
+  //tree hashing: data is split into leafSize-byte leaves that are hashed in parallel, and then combined
+  //pairwise, level by level, with odd nodes promoted unchanged; as for archive Merkle trees, leaves hash
+  //as SHA512(0x00 || leaf) and parents as SHA512(0x01 || left || right)
+  //note: the digest differs from SHA512(data), and depends upon leafSize
+  static auto tree(array_view<uint8_t> data, uint64_t leafSize = 1_MiB, uint threads = 0) -> vector<uint8_t> {
+    leafSize = max<uint64_t>(128, leafSize);
+    uint64_t count = max<uint64_t>(1, (data.size() + leafSize - 1) / leafSize);
+    vector<uint8_t> level;
+    level.resize(count * 64);
+    parallel(count, [&](uint64_t index) {
+      uint64_t offset = index * leafSize;
+      SHA512 hash;
+      hash.input(0x00);
+      hash.input(data.data() + offset, min(leafSize, data.size() - offset));
+      hash.store(level.data() + index * 64);
+    }, threads);
 
-  auto block() -> void {
-    for(auto n : range(16)) w[n] = queue[n];
-    for(auto n : range(16, 80)) {
-      uint64_t a = ror(w[n - 15],  1) ^ ror(w[n - 15],  8) ^ (w[n - 15] >> 7);
-      uint64_t b = ror(w[n -  2], 19) ^ ror(w[n -  2], 61) ^ (w[n -  2] >> 6);
-      w[n] = w[n - 16] + w[n - 7] + a + b;
+    while(count > 1) {
+      uint64_t parents = count >> 1;
+      vector<uint8_t> parent;
+      parent.resize((parents + (count & 1)) * 64);
+      parallel(parents, [&](uint64_t index) {
+        SHA512 hash;
+        hash.input(0x01);
+        hash.input(level.data() + index * 128, 128);
+        hash.store(parent.data() + index * 64);
+      }, threads);
+      if(count & 1) memory::copy(parent.data() + parents * 64, level.data() + (count - 1) * 64, 64);
+      level = move(parent);
+      count = parents + (count & 1);
     }
-    uint64_t t[8];
-    for(auto n : range(8)) t[n] = h[n];
-    for(auto n : range(80)) {
-      uint64_t a = ror(t[0], 28) ^ ror(t[0], 34) ^ ror(t[0], 39);
-      uint64_t b = ror(t[4], 14) ^ ror(t[4], 18) ^ ror(t[4], 41);
-      uint64_t c = (t[0] & t[1]) ^ (t[0] & t[2]) ^ (t[1] & t[2]);
-      uint64_t d = (t[4] & t[5]) ^ (~t[4] & t[6]);
-      uint64_t e = t[7] + w[n] + cube(n) + b + d;
-      t[7] = t[6]; t[6] = t[5]; t[5] = t[4]; t[4] = t[3] + e;
-      t[3] = t[2]; t[2] = t[1]; t[1] = t[0]; t[0] = a + c + e;
-    }
-    for(auto n : range(8)) h[n] += t[n];
+    return level;
+  }
+
+private:
+  auto byte(uint8_t data) -> void {
+    queue[queued] = data;
+    if(++queued == 128) blocks(h, queue, 1), queued = 0;
   }
 
   auto finish() -> void {
@@ -75,7 +102,52 @@ private:
     for(auto n : range(16)) byte(length * 8 >> (15 - n) * 8);
   }
 
-  auto square(uint n) -> uint64_t {
+  //writes the digest of the input so far, without copying through a vector
+  auto store(uint8_t* target) -> void {
+    finish();
+    for(auto h : this->h) {
+      for(auto n : reverse(range(8))) *target++ = h >> n * 8;
+    }
+  }
+
+  static auto blocks(uint64_t* h, const uint8_t* data, uint64_t count) -> void {
+    while(count--) {
+      uint64_t w[80];
+      for(auto n : range(16)) {
+        w[n] = 0;
+        for(auto b : range(8)) w[n] = w[n] << 8 | data[n * 8 + b];
+      }
+      for(auto n : range(16, 80)) {
+        uint64_t a = ror(w[n - 15],  1) ^ ror(w[n - 15],  8) ^ (w[n - 15] >> 7);
+        uint64_t b = ror(w[n -  2], 19) ^ ror(w[n -  2], 61) ^ (w[n -  2] >> 6);
+        w[n] = w[n - 16] + w[n - 7] + a + b;
+      }
+
+      uint64_t t[8];
+      for(auto n : range(8)) t[n] = h[n];
+      //rotate register names instead of values: eight rounds per iteration
+      auto round = [&](uint64_t a, uint64_t b, uint64_t c, uint64_t& d, uint64_t e, uint64_t f, uint64_t g, uint64_t& h, uint n) {
+        uint64_t x = h + (ror(e, 14) ^ ror(e, 18) ^ ror(e, 41)) + (g ^ (e & (f ^ g))) + cube(n) + w[n];
+        uint64_t y = (ror(a, 28) ^ ror(a, 34) ^ ror(a, 39)) + ((a & b) | (c & (a | b)));
+        d += x;
+        h = x + y;
+      };
+      for(uint n = 0; n < 80; n += 8) {
+        round(t[0], t[1], t[2], t[3], t[4], t[5], t[6], t[7], n + 0);
+        round(t[7], t[0], t[1], t[2], t[3], t[4], t[5], t[6], n + 1);
+        round(t[6], t[7], t[0], t[1], t[2], t[3], t[4], t[5], n + 2);
+        round(t[5], t[6], t[7], t[0], t[1], t[2], t[3], t[4], n + 3);
+        round(t[4], t[5], t[6], t[7], t[0], t[1], t[2], t[3], n + 4);
+        round(t[3], t[4], t[5], t[6], t[7], t[0], t[1], t[2], n + 5);
+        round(t[2], t[3], t[4], t[5], t[6], t[7], t[0], t[1], n + 6);
+        round(t[1], t[2], t[3], t[4], t[5], t[6], t[7], t[0], n + 7);
+      }
+      for(auto n : range(8)) h[n] += t[n];
+      data += 128;
+    }
+  }
+
+  static auto square(uint n) -> uint64_t {
     static const uint64_t data[8] = {
       0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
       0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
@@ -83,7 +155,7 @@ private:
     return data[n];
   }
 
-  auto cube(uint n) -> uint64_t {
+  static auto cube(uint n) -> uint64_t {
     static const uint64_t data[80] = {
       0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc,
       0x3956c25bf348b538, 0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118,
@@ -109,8 +181,7 @@ private:
     return data[n];
   }
 
-  uint64_t queue[16] = {0};
-  uint64_t w[80] = {0};
+  uint8_t queue[128] = {0};
   uint64_t h[8] = {0};
   uint64_t queued = 0;
   uint128_t length = 0;
@@ -26,20 +26,25 @@ struct Poly1305 {
   }
 
   auto process(const uint8_t* data, uint64_t size) -> void {
-    while(size--) {
+    //complete any partial block left over from the previous call
+    while(offset && size) {
       buffer[offset++] = *data++;
+      size--;
       if(offset >= 16) {
-        block();
+        block(buffer);
         offset = 0;
       }
     }
+    //whole blocks are read directly from the input
+    for(; size >= 16; data += 16, size -= 16) block(data);
+    while(size--) buffer[offset++] = *data++;
   }
 
   auto finish() -> uint128_t {
     if(offset) {
       buffer[offset++] = 1;
       while(offset < 16) buffer[offset++] = 0;
-      block(true);
+      block(buffer, true);
     }
 
     uint64_t h0 = h[0], h1 = h[1], h2 = h[2];
@@ -82,15 +87,15 @@ struct Poly1305 {
   }
 
 private:
-  auto block(bool last = false) -> void {
+  auto block(const uint8_t* data, bool last = false) -> void {
     uint64_t r0 = r[0], r1 = r[1], r2 = r[2];
     uint64_t h0 = h[0], h1 = h[1], h2 = h[2];
 
     uint64_t s1 = r1 * 20;
     uint64_t s2 = r2 * 20;
 
-    uint64_t t0 = memory::readl<8>(buffer + 0);
-    uint64_t t1 = memory::readl<8>(buffer + 8);
+    uint64_t t0 = memory::readl<8>(data + 0);
+    uint64_t t1 = memory::readl<8>(data + 8);
 
     h0 += ((t0                 ) & 0xfffffffffff);
     h1 += ((t0 >> 44 | t1 << 20) & 0xfffffffffff);
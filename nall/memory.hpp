@@ -4,26 +4,26 @@
 #include <nall/stdint.hpp>
 
 namespace nall::memory {
-  template<typename T = uint8_t> inline auto allocate(uint size) -> T*;
-  template<typename T = uint8_t> inline auto allocate(uint size, const T& value) -> T*;
+  template<typename T = uint8_t> inline auto allocate(uint64_t size) -> T*;
+  template<typename T = uint8_t> inline auto allocate(uint64_t size, const T& value) -> T*;
 
-  template<typename T = uint8_t> inline auto resize(void* target, uint size) -> T*;
+  template<typename T = uint8_t> inline auto resize(void* target, uint64_t size) -> T*;
 
   inline auto free(void* target) -> void;
 
-  template<typename T = uint8_t> inline auto compare(const void* target, uint capacity, const void* source, uint size) -> int;
-  template<typename T = uint8_t> inline auto compare(const void* target, const void* source, uint size) -> int;
+  template<typename T = uint8_t> inline auto compare(const void* target, uint64_t capacity, const void* source, uint64_t size) -> int;
+  template<typename T = uint8_t> inline auto compare(const void* target, const void* source, uint64_t size) -> int;
 
-  template<typename T = uint8_t> inline auto icompare(const void* target, uint capacity, const void* source, uint size) -> int;
-  template<typename T = uint8_t> inline auto icompare(const void* target, const void* source, uint size) -> int;
+  template<typename T = uint8_t> inline auto icompare(const void* target, uint64_t capacity, const void* source, uint64_t size) -> int;
+  template<typename T = uint8_t> inline auto icompare(const void* target, const void* source, uint64_t size) -> int;
 
-  template<typename T = uint8_t> inline auto copy(void* target, uint capacity, const void* source, uint size) -> T*;
-  template<typename T = uint8_t> inline auto copy(void* target, const void* source, uint size) -> T*;
+  template<typename T = uint8_t> inline auto copy(void* target, uint64_t capacity, const void* source, uint64_t size) -> T*;
+  template<typename T = uint8_t> inline auto copy(void* target, const void* source, uint64_t size) -> T*;
 
-  template<typename T = uint8_t> inline auto move(void* target, uint capacity, const void* source, uint size) -> T*;
-  template<typename T = uint8_t> inline auto move(void* target, const void* source, uint size) -> T*;
+  template<typename T = uint8_t> inline auto move(void* target, uint64_t capacity, const void* source, uint64_t size) -> T*;
+  template<typename T = uint8_t> inline auto move(void* target, const void* source, uint64_t size) -> T*;
 
-  template<typename T = uint8_t> inline auto fill(void* target, uint capacity, const T& value = {}) -> T*;
+  template<typename T = uint8_t> inline auto fill(void* target, uint64_t capacity, const T& value = {}) -> T*;
 
   template<typename T> inline auto assign(T* target) -> void {}
   template<typename T, typename U, typename... P> inline auto assign(T* target, const U& value, P&&... p) -> void;
@@ -42,17 +42,17 @@ namespace nall::memory {
 //as this library is used extensively by nall/string, and most strings tend to be small,
 //this library hand-codes these functions instead. surprisingly, it's a substantial speedup
 
-template<typename T> auto allocate(uint size) -> T* {
+template<typename T> auto allocate(uint64_t size) -> T* {
   return (T*)malloc(size * sizeof(T));
 }
 
-template<typename T> auto allocate(uint size, const T& value) -> T* {
+template<typename T> auto allocate(uint64_t size, const T& value) -> T* {
   auto result = allocate<T>(size);
   if(result) fill<T>(result, size, value);
   return result;
 }
 
-template<typename T> auto resize(void* target, uint size) -> T* {
+template<typename T> auto resize(void* target, uint64_t size) -> T* {
   return (T*)realloc(target, size * sizeof(T));
 }
 
@@ -60,7 +60,7 @@ auto free(void* target) -> void {
   ::free(target);
 }
 
-template<typename T> auto compare(const void* target, uint capacity, const void* source, uint size) -> int {
+template<typename T> auto compare(const void* target, uint64_t capacity, const void* source, uint64_t size) -> int {
   auto t = (uint8_t*)target;
   auto s = (uint8_t*)source;
   auto l = min(capacity, size) * sizeof(T);
@@ -73,11 +73,11 @@ template<typename T> auto compare(const void* target, uint capacity, const void*
   return -(capacity < size);
 }
 
-template<typename T> auto compare(const void* target, const void* source, uint size) -> int {
+template<typename T> auto compare(const void* target, const void* source, uint64_t size) -> int {
   return compare<T>(target, size, source, size);
 }
 
-template<typename T> auto icompare(const void* target, uint capacity, const void* source, uint size) -> int {
+template<typename T> auto icompare(const void* target, uint64_t capacity, const void* source, uint64_t size) -> int {
   auto t = (uint8_t*)target;
   auto s = (uint8_t*)source;
   auto l = min(capacity, size) * sizeof(T);
@@ -91,11 +91,11 @@ template<typename T> auto icompare(const void* target, uint capacity, const void
   return -(capacity < size);
 }
 
-template<typename T> auto icompare(const void* target, const void* source, uint size) -> int {
+template<typename T> auto icompare(const void* target, const void* source, uint64_t size) -> int {
   return icompare<T>(target, size, source, size);
 }
 
-template<typename T> auto copy(void* target, uint capacity, const void* source, uint size) -> T* {
+template<typename T> auto copy(void* target, uint64_t capacity, const void* source, uint64_t size) -> T* {
   auto t = (uint8_t*)target;
   auto s = (uint8_t*)source;
   auto l = min(capacity, size) * sizeof(T);
@@ -103,11 +103,11 @@ template<typename T> auto copy(void* target, uint capacity, const void* source,
   return (T*)target;
 }
 
-template<typename T> auto copy(void* target, const void* source, uint size) -> T* {
+template<typename T> auto copy(void* target, const void* source, uint64_t size) -> T* {
   return copy<T>(target, size, source, size);
 }
 
-template<typename T> auto move(void* target, uint capacity, const void* source, uint size) -> T* {
+template<typename T> auto move(void* target, uint64_t capacity, const void* source, uint64_t size) -> T* {
   auto t = (uint8_t*)target;
   auto s = (uint8_t*)source;
   auto l = min(capacity, size) * sizeof(T);
@@ -121,11 +121,11 @@ template<typename T> auto move(void* target, uint capacity, const void* source,
   return (T*)target;
 }
 
-template<typename T> auto move(void* target, const void* source, uint size) -> T* {
+template<typename T> auto move(void* target, const void* source, uint64_t size) -> T* {
   return move<T>(target, size, source, size);
 }
 
-template<typename T> auto fill(void* target, uint capacity, const T& value) -> T* {
+template<typename T> auto fill(void* target, uint64_t capacity, const T& value) -> T* {
   auto t = (T*)target;
   while(capacity--) *t++ = value;
   return (T*)target;
@@ -0,0 +1,49 @@
+#pragma once
+
+//simple data-parallel helpers built on nall::thread
+//work items are handed out dynamically, so uneven item costs balance across threads
+
+#include <nall/platform.hpp>
+#include <nall/function.hpp>
+#include <nall/thread.hpp>
+#include <nall/vector.hpp>
+
+namespace nall {
+
+//returns the number of logical processors available
+inline auto processors() -> uint {
+  #if defined(API_WINDOWS)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return max(1u, (uint)info.dwNumberOfProcessors);
+  #else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (uint)count : 1u;
+  #endif
+}
+
+//invokes callback(index) once for every index in [0, count)
+//the calling thread participates in the work, and all indices are complete upon return
+//threads = 0 uses one thread per processor
+inline auto parallel(uint64_t count, const function<void (uint64_t)>& callback, uint threads = 0) -> void {
+  if(!threads) threads = processors();
+  if(threads > count) threads = count;
+  if(threads <= 1) {
+    for(uint64_t index = 0; index < count; index++) callback(index);
+    return;
+  }
+
+  std::atomic<uint64_t> next{0};
+  auto worker = [&](uintptr) {
+    uint64_t index;
+    while((index = next++) < count) callback(index);
+  };
+
+  vector<thread> workers;
+  workers.reserve(threads - 1);
+  for(uint n = 1; n < threads; n++) workers.append(thread::create(worker));
+  worker(0);
+  for(auto& thread : workers) thread.join();
+}
+
+}
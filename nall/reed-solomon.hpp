@@ -10,6 +10,7 @@ struct ReedSolomon {
   static_assert(Parity <=  32 && Parity > 0);
 
   using Field = GaloisField<uint8_t, 255, 0x11d>;
+  using Region = GaloisRegion<0x11d>;
   template<uint Rows, uint Cols = 1> using Polynomial = Matrix<Field, Rows, Cols>;
 
   template<uint Size>
@@ -70,22 +71,71 @@ struct ReedSolomon {
     }
   }
 
-  auto generateParity() -> void {
-    static const Polynomial<Parity, Parity> matrix = [] {
+  //each parity symbol is a fixed linear combination of the message symbols: coefficients(m, p) is the
+  //contribution of message symbol m to parity symbol p, derived from the syndromes of a unit message
+  static auto coefficients() -> const Polynomial<Inputs, Parity>& {
+    static const Polynomial<Inputs, Parity> coefficients = [] {
       Polynomial<Parity, Parity> matrix{};
       for(uint row : range(Parity)) {
         for(uint col : range(Parity)) {
           matrix(row, col) = Field::exp(row * col);
         }
       }
-      if(auto result = matrix.invert()) return *result;
-      throw;  //should never occur
+      auto inverted = matrix.invert();
+      if(!inverted) throw;  //should never occur
+
+      Polynomial<Inputs, Parity> coefficients{};
+      for(uint m : range(Inputs)) {
+        Polynomial<Parity> syndromes;
+        for(uint p : range(Parity)) syndromes[p] = Field::exp(p * (Length - (m + 1)));
+        auto parity = inverted() * syndromes;
+        for(uint p : range(Parity)) coefficients(m, p) = parity[Parity - (p + 1)];
+      }
+      return coefficients;
     }();
+    return coefficients;
+  }
 
-    for(uint p : range(Parity)) message[Inputs + p] = 0;
-    calculateSyndromes();
-    auto parity = matrix * syndromes;
-    for(uint p : range(Parity)) message[Inputs + p] = parity[Parity - (p + 1)];
+  auto generateParity() -> void {
+    auto& coefficients = ReedSolomon::coefficients();
+    Field parity[Parity];
+    for(uint m : range(Inputs)) {
+      for(uint p : range(Parity)) parity[p] += message[m] * coefficients(m, p);
+    }
+    for(uint p : range(Parity)) message[Inputs + p] = parity[p];
+  }
+
+  //region coding: many codewords are coded at once, where codeword n is formed from the nth symbol
+  //of each of a list of regions, size symbols long
+
+  //messages[Inputs] are read, and parities[Parity] are written
+  static auto generateParity(const uint8_t* const messages[], uint8_t* const parities[], uint64_t size) -> void {
+    static const auto multipliers = [] {
+      array<typename Region::Multiplier[Inputs * Parity]> multipliers;
+      for(uint m : range(Inputs)) {
+        for(uint p : range(Parity)) multipliers[m * Parity + p] = uint8_t(coefficients()(m, p));
+      }
+      return multipliers;
+    }();
+    for(uint p : range(Parity)) ::memset(parities[p], 0, size);
+    for(uint m : range(Inputs)) {
+      for(uint p : range(Parity)) Region::multiplyAccumulate(parities[p], messages[m], size, multipliers[m * Parity + p]);
+    }
+  }
+
+  //codewords[Length] are read, and syndromes[Parity] are written: these are all zero for codewords without errors
+  static auto calculateSyndromes(const uint8_t* const codewords[], uint8_t* const syndromes[], uint64_t size) -> void {
+    static const auto multipliers = [] {
+      array<typename Region::Multiplier[Length * Parity]> multipliers;
+      for(uint m : range(Length)) {
+        for(uint p : range(Parity)) multipliers[m * Parity + p] = Field::exp(p * (Length - (m + 1)));
+      }
+      return multipliers;
+    }();
+    for(uint p : range(Parity)) ::memset(syndromes[p], 0, size);
+    for(uint m : range(Length)) {
+      for(uint p : range(Parity)) Region::multiplyAccumulate(syndromes[p], codewords[m], size, multipliers[m * Parity + p]);
+    }
   }
 
   auto syndromesAreZero() -> bool {
@@ -238,14 +238,14 @@ template<> struct stringify<array_view<uint8_t>> {
   stringify(const array_view<uint8_t>& source) : _view(source) {}
   auto data() const -> const char* { return _view.data<const char>(); }
   auto size() const -> uint { return _view.size(); }
-  const array_view<uint8_t>& _view;
+  const array_view<uint8_t> _view;  //held by value: make_string() passes a temporary
 };
 
 template<> struct stringify<const array_view<uint8_t>&> {
   stringify(const array_view<uint8_t>& source) : _view(source) {}
   auto data() const -> const char* { return _view.data<const char>(); }
   auto size() const -> uint { return _view.size(); }
-  const array_view<uint8_t>& _view;
+  const array_view<uint8_t> _view;  //held by value: make_string() passes a temporary
 };
 
 template<> struct stringify<string_pascal> {
@@ -73,7 +73,11 @@ auto thread::exit() -> void {
 namespace nall {
 
 struct thread {
+  thread() = default;
+  thread(const thread&) = delete;
+  inline thread(thread&& source);
   inline ~thread();
+  inline auto operator=(thread&& source) -> thread&;
   inline auto join() -> void;
 
   static inline auto create(const function<void (uintptr)>& callback, uintptr parameter = 0, uint stacksize = 0) -> thread;
@@ -96,6 +100,11 @@ inline auto WINAPI _threadCallback(void* parameter) -> DWORD {
   return 0;
 }
 
+//ownership of the handle is transferred so that it is only closed once
+thread::thread(thread&& source) {
+  operator=(move(source));
+}
+
 thread::~thread() {
   if(handle) {
     CloseHandle(handle);
@@ -103,6 +112,14 @@ thread::~thread() {
   }
 }
 
+auto thread::operator=(thread&& source) -> thread& {
+  if(this == &source) return *this;
+  if(handle) CloseHandle(handle);
+  handle = source.handle;
+  source.handle = 0;
+  return *this;
+}
+
 auto thread::join() -> void {
   if(handle) {
     WaitForSingleObject(handle, INFINITE);